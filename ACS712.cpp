@@ -28,6 +28,11 @@ ACS712::ACS712( const char *name, pin_t pin, ACS_VERSION version,
 
 void ACS712::loop(){
 
+	loop( uptime() );
+}
+
+void ACS712::loop( knob_time_t now ){
+
 	//static int i;
 
 	knob_value_t in, val;
@@ -68,9 +73,11 @@ void ACS712::loop(){
 
 	val = (knob_value_t) ( _div_avg * _ACS_MUL[ 1 ] );
 
+	_sampleTime = now;
+
 	if( modify( &val ) ) {
 
-		activate( val );
+		activate( val, now );
 	}
 
 }
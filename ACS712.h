@@ -25,6 +25,7 @@ namespace Knobs {
 			ACS712( const char *name, pin_t pin, ACS_VERSION version, knob_value_t max, knob_value_t samples );
 
 			virtual void loop();
+			virtual void loop( knob_time_t now );
 
 	};
 
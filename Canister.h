@@ -1,32 +1,75 @@
 #ifndef CANISTER_H
 #define CANISTER_H
 
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Pool.h"
+
 /*
  * Very lightweight container implementation using
  * arrays with fixed maximum size.
+ *
+ * Canister<T,N> holds pointers to up to N items. Its storage can be
+ * exchanged per instance with reserve(). Canister<T,0> has no storage
+ * of its own and must be given some.
+ *
+ * Crate<T,N> holds up to N items by value in one block of memory.
+ *
+ * Shelf<T,N> lends slots to Canisters which are full, so each one
+ * takes as many as it holds more. Slots are given back when it moves.
+ *
+ * Both are iterated using a Cursor which lives on the stack. So any
+ * number of iterations can run at the same time, nested or from callbacks.
  */
 
 namespace Knobs {
 
+	// Items which couldn't be added because a Canister/Crate was full.
+	inline uint16_t &canisterOverflows() {
+		static uint16_t overflows = 0;
+		return overflows;
+	}
+
+	template <typename T>
+	class Cursor;
+
 	template <typename T, int N>
-	class Canister {
+	class Shelf;
 
-		private:
+	template <typename T>
+	class CanisterBase {
+
+		friend class Cursor<T>;
+		template <typename, int> friend class Shelf;
 
-			T *_reservoir[ N ];
+		protected:
 
-			int _fill;
+			T **_reservoir;
 
-			int _current;
+			uint8_t _capacity;
+			uint8_t _fill;
+			uint8_t _overflow;
+
+			CanisterBase( T **reservoir, uint8_t capacity )
+					: _reservoir( reservoir ), _capacity( capacity ),
+					  _fill( 0 ), _overflow( 0 ) {}
 
 		public:
 			/**
 			 * Add one item to end of list
-			 * returns false if the list is full.
+			 * returns false if the list is full. This is counted
+			 * in overflow() and canisterOverflows().
 			 */
 			inline bool add( T& item ) {
 
-				if( _fill == N ) return false;
+				if( _fill == _capacity ) {
+
+					if( _overflow < 0xff ) _overflow++;
+					canisterOverflows()++;
+
+					return false;
+				}
 
 				_reservoir[ _fill++ ] = &item;
 
@@ -34,20 +77,141 @@ namespace Knobs {
 			}
 
 			/**
-			 * In order to save space this class has the "iterator" integrated.
+			 * Use other storage. Items already added are copied over.
+			 * returns false if it is too small.
 			 */
+			bool reserve( T **storage, int capacity ) {
+
+				if( capacity < _fill || capacity > 0xff ) return false;
+
+				for( uint8_t i = 0; i < _fill; i++ ) storage[ i ] = _reservoir[ i ];
+
+				_reservoir = storage;
+				_capacity = capacity;
+
+				return true;
+			}
+
+			inline T *get( int i ) {
+
+				return i < _fill ? _reservoir[ i ] : (T*)0;
+			}
+
+			inline int fill() {
+				return _fill;
+			}
+			inline int capacity() {
+				return _capacity;
+			}
+			// amount of failed add()s
+			inline int overflow() {
+				return _overflow;
+			}
+	};
+
+	template <typename T, int N>
+	class Canister : public CanisterBase<T> {
+
+		static_assert( N <= 0xff, "A Canister holds max. 255 items" );
+
+		private:
+
+			T *_storage[ N ];
+
+		public:
+			Canister() : CanisterBase<T>( _storage, N ) {}
+	};
+
+	template <typename T>
+	class Canister<T, 0> : public CanisterBase<T> {
+
+		public:
+			Canister() : CanisterBase<T>( (T**)0, 0 ) {}
+	};
+
+	// Iterate a Canister:
+	//
+	//   Cursor<Valve> it( _valves );
+	//   for( valve = it.next(); valve; valve = it.next() ) ...
+	template <typename T>
+	class Cursor {
+
+		private:
+
+			T * const *_at;
+			T * const *_end;
+
+		public:
+
+			Cursor( CanisterBase<T> &canister )
+					: _at( canister._reservoir ),
+					  _end( canister._reservoir + canister._fill ) {}
+
 			inline T *next() {
 
-				if( _current >= _fill ) return (T*)0;
+				if( _at >= _end ) return (T*)0;
 
-				return _reservoir[ _current++ ];
+				return *_at++;
 			}
+	};
+
+	// Crate: Up to N items of type T stored by value in one block.
+	// Iteration touches contiguous memory only.
+	template <typename T, int N>
+	class Crate {
+
+		static_assert( N <= 0xff, "A Crate holds max. 255 items" );
+
+		private:
+
+			alignas( T ) uint8_t _storage[ N > 0 ? N : 1 ][ sizeof( T ) ];
+
+			uint8_t _fill;
+			uint8_t _overflow;
+
+		public:
+
+			class Cursor {
 
-			inline T *first() {
+				private:
+					T *_at;
+					T *_end;
 
-				_current = 0;
+				public:
+					Cursor( Crate &crate )
+							: _at( crate.get( 0 ) ), _end( _at + crate._fill ) {}
 
-				return next();
+					inline T *next() {
+
+						if( _at >= _end ) return (T*)0;
+
+						return _at++;
+					}
+			};
+
+			Crate() : _fill( 0 ), _overflow( 0 ) {}
+
+			/**
+			 * Construct new item in place.
+			 * returns NULL if the crate is full.
+			 */
+			template <typename... As>
+			T *make( As... args ) {
+
+				if( _fill >= N ) {
+
+					if( _overflow < 0xff ) _overflow++;
+					canisterOverflows()++;
+
+					return (T*)0;
+				}
+
+				return new( PoolTag(), _storage[ _fill++ ] ) T( args... );
+			}
+
+			inline T *get( int i ) {
+
+				return (T*)_storage[ i ];
 			}
 
 			inline int fill() {
@@ -56,10 +220,111 @@ namespace Knobs {
 			inline int capacity() {
 				return N;
 			}
+			inline int overflow() {
+				return _overflow;
+			}
+	};
+
+	// Shelf: N slots with static storage for Canisters which are full.
+	// A Canister grows in place if the slot behind it is free. Otherwise
+	// it moves to the first free run of slots which fits and gives its
+	// old ones back. Free slots are NULL.
+	template <typename T, int N>
+	class Shelf {
+
+		private:
+			static T *_slots[ N > 0 ? N : 1 ];
+			static uint16_t _used;
+
+			static bool _owns( T **slot ) {
+				return slot >= _slots && slot < _slots + N;
+			}
+
+			static void _free( T **slots, uint8_t n ) {
+
+				if( !_owns( slots ) ) return;
+
+				for( uint8_t i = 0; i < n; i++ ) slots[ i ] = (T*)0;
+				_used -= n;
+			}
+
+		public:
+			// make room for one more item. Returns false if exhausted.
+			static bool grow( CanisterBase<T> &canister ) {
+
+				T **old = canister._reservoir;
+				uint8_t fill = canister._fill, capacity = canister._capacity;
+				int at, run;
+
+				if( capacity == 0xff ) return false;
+
+				// in place
+				if( _owns( old ) && old + capacity < _slots + N && !old[ capacity ] ) {
+
+					_used++;
+					canister._capacity++;
+
+					return true;
+				}
+
+				// first fit. Slots still taken by the Canister itself
+				// are not free but only the fill ones are copied
+				for( at = 0, run = 0; at < N && run < fill + 1; at++ )
+						run = _slots[ at ] ? 0 : run + 1;
+
+				if( run < fill + 1 ) return false;
+
+				at -= run;
+				for( uint8_t i = 0; i < fill; i++ ) _slots[ at + i ] = old[ i ];
+
+				_free( old, capacity );
+				_used += fill + 1;
+
+				canister._reservoir = _slots + at;
+				canister._capacity = fill + 1;
+
+				return true;
+			}
+
+			// move canister to storage (see CanisterBase::reserve) and
+			// give its slots back
+			static bool reserve( CanisterBase<T> &canister, T **storage, int capacity ) {
+
+				T **old = canister._reservoir;
+				uint8_t n = canister._capacity;
+
+				if( !canister.reserve( storage, capacity ) ) return false;
+
+				_free( old, n );
 
+				return true;
+			}
+
+			// give back the slots of canister which is gone
+			static void release( CanisterBase<T> &canister ) {
+
+				_free( canister._reservoir, canister._capacity );
+
+				canister._reservoir = (T**)0;
+				canister._capacity = 0;
+				canister._fill = 0;
+			}
+
+			// slots taken
+			static int used() {
+				return _used;
+			}
+
+			static int capacity() {
+				return N;
+			}
 	};
 
-	//#include "Canister.tpp"
+	template <typename T, int N>
+	T *Shelf<T, N>::_slots[ N > 0 ? N : 1 ];
+
+	template <typename T, int N>
+	uint16_t Shelf<T, N>::_used = 0;
 }
 
 #endif
@@ -0,0 +1,64 @@
+#include "Clock.h"
+
+#include <Arduino.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+using namespace Knobs;
+
+/*****************************************************************************
+*
+*   C L O C K
+*
+*****************************************************************************/
+
+static uint32_t _defaultSource() {
+#ifdef KNOBS_MICROS
+	return micros();
+#else
+	return millis();
+#endif
+}
+
+static clock_source_t _source = _defaultSource;
+
+static uint32_t _last = 0;
+static knob_time_t _high = 0;
+
+void Knobs::clockSource( clock_source_t source ) {
+
+	_source = source ? source : _defaultSource;
+
+	_last = 0;
+	_high = 0;
+}
+
+uint32_t Knobs::clockRead() {
+
+	return _source();
+}
+
+knob_time_t Knobs::uptime() {
+
+	uint32_t raw;
+	knob_time_t time;
+	knobs_irq_t irq;
+
+	// an interrupt in between would see a wrap twice
+	KNOBS_LOCK( irq );
+
+	raw = _source();
+
+	if( raw < _last ) _high += (knob_time_t)1 << 32;
+
+	_last = raw;
+	time = _high | raw;
+
+	KNOBS_UNLOCK( irq );
+
+	return time;
+}
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,48 @@
+#ifndef KNOBS_CLOCK_H
+#define KNOBS_CLOCK_H
+
+#include <stdint.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+#include "knobs_common.h"
+
+/*
+ * Time base of all Knobs.
+ *
+ * A 32 bit counter (millis(), micros() or a hardware timer) is extended
+ * to a monotonic 64 bit time. The unit is milliseconds or microseconds
+ * if KNOBS_MICROS is defined. See KNOB_MS/KNOB_US.
+ *
+ * uptime() must be called at least once per wrap of the counter
+ * (49 days for millis(), 71 minutes for micros()). Panel and Transducer
+ * do so every loop.
+ */
+
+namespace Knobs {
+
+	// returns a free running 32 bit counter in knob time units
+	typedef uint32_t (*clock_source_t)();
+
+	// Use other counter. NULL: millis() or micros().
+	// Set before any device is looped.
+	void clockSource( clock_source_t source );
+
+	// current counter value. Safe to call from interrupts.
+	uint32_t clockRead();
+
+	// monotonic time in knob time units. Blocks interrupts shortly and
+	// gives back their state, so it may be called from interrupts.
+	knob_time_t uptime();
+
+	// extend a counter value read not long before (or after) now
+	inline knob_time_t uptimeOf( uint32_t raw, knob_time_t now ) {
+		return now - (int32_t)( (uint32_t)now - raw );
+	}
+}
+
+#pragma GCC diagnostic pop
+
+#endif
@@ -0,0 +1,311 @@
+#include "Encoder.h"
+
+#include <Arduino.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+using namespace Knobs;
+
+static inline knob_time_t MAX( knob_time_t v1, knob_time_t v2 ) {
+	return v1 > v2 ? v1 : v2;
+}
+
+/*****************************************************************************
+*
+*   E N C O D E R
+*
+*****************************************************************************/
+
+// Quarter steps for a change of A/B. Index is old AB << 2 | new AB.
+// 0 for no change and for invalid transitions where both lines changed.
+static const int8_t _TRANSITIONS[ 16 ] = {
+	 0, -1,  1,  0,
+	 1,  0,  0, -1,
+	-1,  0,  0,  1,
+	 0,  1, -1,  0
+};
+
+Encoder::Encoder( const char *name, pin_t pinA, pin_t pinB )
+		: Device( name ), _pinA( pinA ), _pinB( pinB ) {
+
+	_inA = _inB = NULL;
+	_maskA = _maskB = 0;
+	_sampleA = _sampleB = NULL;
+
+#ifdef portInputRegister
+	uint8_t portA = digitalPinToPort( pinA ),
+	        portB = digitalPinToPort( pinB );
+
+	if( portA != NOT_A_PORT && portB != NOT_A_PORT ) {
+
+		_inA = portInputRegister( portA );
+		_inB = portInputRegister( portB );
+	}
+	_maskA = digitalPinToBitMask( pinA );
+	_maskB = digitalPinToBitMask( pinB );
+#endif
+
+	_irq = -1;
+
+	_quarters = 0;
+	_used = 0;
+
+	_steps = 4;
+	_invert = false;
+
+	_value = 0;
+	_min = KNOB_VAL_MIN;
+	_max = KNOB_VAL_MAX;
+
+	_timeAccel = 0;
+	_maxAccel = 1;
+
+	_lastTime = 0;
+	_timeUnchanged = 0;
+	_lastStep = 0;
+
+	pinMode( pinA, INPUT );
+	pinMode( pinB, INPUT );
+
+	_ab = _read();
+}
+
+Encoder& Encoder::pullup( bool on ) {
+
+	pinMode( _pinA, on ? INPUT_PULLUP : INPUT );
+	pinMode( _pinB, on ? INPUT_PULLUP : INPUT );
+
+	_ab = _read();
+
+	return *this;
+}
+
+Encoder& Encoder::invert( bool on ) {
+	_invert = on;
+	return *this;
+}
+
+Encoder& Encoder::steps( uint8_t steps ) {
+	_steps = steps ? steps : 1;
+	return *this;
+}
+
+Encoder& Encoder::range( knob_value_t min, knob_value_t max ) {
+
+	_min = min;
+	_max = max;
+
+	if( _value < _min ) _value = _min;
+	if( _value > _max ) _value = _max;
+
+	return *this;
+}
+
+Encoder& Encoder::accelerate( knob_time_t time, knob_value_t max ) {
+
+	_timeAccel = time;
+	_maxAccel = max > 1 ? max : 1;
+
+	return *this;
+}
+
+knob_value_t Encoder::value() {
+	return _value;
+}
+
+Encoder& Encoder::value( knob_value_t value ) {
+	_value = value;
+	return *this;
+}
+
+// direct read of both lines. AB in bit 1 and 0.
+uint8_t Encoder::_read() {
+
+	bool a, b;
+
+	if( _inA ) {
+		a = *_inA & _maskA;
+		b = *_inB & _maskB;
+	} else {
+		a = digitalRead( _pinA );
+		b = digitalRead( _pinB );
+	}
+
+	return ( a ? 2 : 0 ) | ( b ? 1 : 0 );
+}
+
+void Encoder::_decode( uint8_t ab ) {
+
+	_quarters += _TRANSITIONS[ ( _ab << 2 ) | ab ];
+	_ab = ab;
+}
+
+void Encoder::_attach( PortSnapshot *snapshot ) {
+
+	_sampleA = snapshot ? snapshot->use( _pinA ) : NULL;
+	_sampleB = snapshot ? snapshot->use( _pinB ) : NULL;
+
+	if( !_sampleA || !_sampleB ) _sampleA = _sampleB = NULL;
+}
+
+void Encoder::loop() {
+
+	loop( uptime() );
+}
+
+void Encoder::loop( knob_time_t now ) {
+
+	if( _mute ) return;
+
+	if( _irq < 0 ) {
+
+		if( _sampleA ) {
+			_decode( ( ( *_sampleA & _maskA ) ? 2 : 0 ) | ( ( *_sampleB & _maskB ) ? 1 : 0 ) );
+		} else {
+			_decode( _read() );
+		}
+	}
+
+	int32_t quarters;
+
+	noInterrupts();
+	quarters = _quarters;
+	interrupts();
+
+	knob_value_t oldValue = _value;
+
+	// remainder stays for the next loop
+	int32_t detents = ( quarters - _used ) / _steps;
+
+	if( detents ) {
+
+		_used += detents * _steps;
+
+		if( _invert ) detents = -detents;
+
+		knob_time_t since = now - _lastStep;
+
+		if( _timeAccel && since < _timeAccel ) {
+
+			detents *= 1 + ( _maxAccel - 1 ) * ( _timeAccel - since ) / _timeAccel;
+		}
+
+		_lastStep = now;
+
+		big_knob_value_t value = (big_knob_value_t)_value + detents;
+
+		if( value < _min ) value = _min;
+		if( value > _max ) value = _max;
+
+		_value = value;
+	}
+
+	if( _value != oldValue ) _timeUnchanged = 0;
+	else _timeUnchanged += now - _lastTime;
+
+	_lastTime = now;
+
+	_activate( _value, oldValue, _timeUnchanged, now );
+}
+
+knob_time_t Encoder::due( knob_time_t now ) {
+
+	if( _mute ) return KNOB_TIME_NEVER;
+
+	// lines must be sampled
+	if( _irq < 0 ) return 0;
+
+	int32_t pending;
+
+	noInterrupts();
+	pending = _quarters - _used;
+	interrupts();
+
+	if( pending >= _steps || pending <= -_steps ) return 0;
+
+	return MAX( 0, _due( _value, _timeUnchanged + now - _lastTime ) );
+}
+
+
+/*
+ * Interrupt mode
+ *
+ * Like Knob there is a fixed amount of trampolines.
+ */
+
+static Encoder *_irqEncoders[ KNOBS_ENCODER_INTERRUPTS ];
+
+template <int N>
+static void _irqTrampoline() {
+	_irqEncoders[ N ]->edge();
+}
+
+typedef void (*_irq_f)();
+
+#if KNOBS_ENCODER_INTERRUPTS < 1 || KNOBS_ENCODER_INTERRUPTS > 4
+	#error "KNOBS_ENCODER_INTERRUPTS must be 1..4"
+#endif
+
+static const _irq_f _irqTrampolines[ KNOBS_ENCODER_INTERRUPTS ] = {
+	_irqTrampoline<0>
+#if KNOBS_ENCODER_INTERRUPTS > 1
+	, _irqTrampoline<1>
+#endif
+#if KNOBS_ENCODER_INTERRUPTS > 2
+	, _irqTrampoline<2>
+#endif
+#if KNOBS_ENCODER_INTERRUPTS > 3
+	, _irqTrampoline<3>
+#endif
+};
+
+Encoder& Encoder::interrupt( bool on ) {
+
+	int irqA = digitalPinToInterrupt( _pinA ),
+	    irqB = digitalPinToInterrupt( _pinB );
+
+	if( on && _irq < 0 ) {
+
+		for( int8_t slot = 0; slot < KNOBS_ENCODER_INTERRUPTS; slot++ ) {
+
+			if( _irqEncoders[ slot ] ) continue;
+
+			_irqEncoders[ slot ] = this;
+
+			// continue from current lines
+			_ab = _read();
+			_irq = slot;
+
+			if( irqA != NOT_AN_INTERRUPT )
+					attachInterrupt( irqA, _irqTrampolines[ slot ], CHANGE );
+			if( irqB != NOT_AN_INTERRUPT )
+					attachInterrupt( irqB, _irqTrampolines[ slot ], CHANGE );
+			break;
+		}
+
+	} else if( !on && _irq >= 0 ) {
+
+		if( irqA != NOT_AN_INTERRUPT ) detachInterrupt( irqA );
+		if( irqB != NOT_AN_INTERRUPT ) detachInterrupt( irqB );
+
+		_irqEncoders[ _irq ] = NULL;
+		_irq = -1;
+	}
+
+	return *this;
+}
+
+bool Encoder::interrupted() {
+	return _irq >= 0;
+}
+
+void Encoder::edge() {
+
+	if( _irq < 0 ) return;
+
+	_decode( _read() );
+}
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,114 @@
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stdint.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+#include "Knob.h"
+
+// Amount of Encoders which can be operated by interrupt
+#ifndef KNOBS_ENCODER_INTERRUPTS
+	#define KNOBS_ENCODER_INTERRUPTS 2
+#endif
+
+namespace Knobs {
+
+	// Encoder: An incremental rotary encoder with A/B quadrature output.
+	//
+	// Every change of A/B is looked up in a transition table which
+	// yields -1, 0 or +1 quarter steps. Invalid transitions (both lines
+	// changed) are ignored.
+	//
+	// Without interrupt the lines are sampled every loop (or from the
+	// Panel's port snapshot) which is fine for slowly turned knobs.
+	// In interrupt mode every edge is decoded in the ISR.
+	//
+	// The value is the count of detents. Handlers see it like the value
+	// of a Lever so Toggle, Over and Under work as usual.
+	class Encoder : public Device {
+
+		private:
+
+			pin_t _pinA, _pinB;
+
+			// port registers for fast reads in the ISR
+			volatile uint8_t *_inA, *_inB;
+			uint8_t _maskA, _maskB;
+
+			// sampled by Panel
+			const uint8_t *_sampleA, *_sampleB;
+
+			int8_t _irq;
+
+			// written by ISR
+			volatile uint8_t _ab;
+			volatile int32_t _quarters;
+
+			// quarters already counted in _value
+			int32_t _used;
+
+			uint8_t _steps;
+			bool _invert;
+
+			knob_value_t _value;
+			knob_value_t _min, _max;
+
+			knob_time_t _timeAccel;
+			knob_value_t _maxAccel;
+
+			knob_time_t _lastTime;
+			knob_time_t _timeUnchanged;
+			knob_time_t _lastStep;
+
+			uint8_t _read();
+			void _decode( uint8_t ab );
+
+		protected:
+
+			virtual void _attach( PortSnapshot *snapshot );
+
+		public:
+
+			Encoder( const char *name, pin_t pinA, pin_t pinB );
+
+			Encoder& pullup( bool on );
+
+			// count in the other direction
+			Encoder& invert( bool on );
+
+			// quarter steps per detent. (1, 2 or 4. Default: 4)
+			Encoder& steps( uint8_t steps );
+
+			// Limit value to min..max
+			Encoder& range( knob_value_t min, knob_value_t max );
+
+			// Detents which follow each other faster than time count up
+			// to max times. (linear in between) 0 switches it off.
+			Encoder& accelerate( knob_time_t time, knob_value_t max );
+
+			// use pin change interrupts on both lines. Stays in polling mode
+			// if all KNOBS_ENCODER_INTERRUPTS are in use. If the pins have
+			// no external interrupt call edge() from your own ISR.
+			Encoder& interrupt( bool on );
+			// true if operated by interrupt
+			bool interrupted();
+
+			// decode edge. Called from interrupt
+			void edge();
+
+			knob_value_t value();
+			Encoder& value( knob_value_t value );
+
+			virtual void loop();
+			virtual void loop( knob_time_t now );
+
+			virtual knob_time_t due( knob_time_t now );
+	};
+}
+
+#pragma GCC diagnostic pop
+
+#endif
@@ -0,0 +1,151 @@
+#include "EventQueue.h"
+
+#include <Arduino.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+using namespace Knobs;
+
+#if KNOBS_EVENT_QUEUE_SIZE & ( KNOBS_EVENT_QUEUE_SIZE - 1 ) || KNOBS_EVENT_QUEUE_SIZE > 128
+	#error "KNOBS_EVENT_QUEUE_SIZE must be a power of 2 not bigger than 128"
+#endif
+
+#if KNOBS_EVENT_QUEUE_DEVICES > 255
+	#error "KNOBS_EVENT_QUEUE_DEVICES must not exceed 255"
+#endif
+
+#define _MASK ( KNOBS_EVENT_QUEUE_SIZE - 1 )
+
+// Each index is written by one side only. Acquire/release makes sure
+// the event is complete before the other side sees the new index.
+// (On AVR these are plain byte accesses.)
+#define _LOAD( v ) __atomic_load_n( &(v), __ATOMIC_ACQUIRE )
+#define _STORE( v, n ) __atomic_store_n( &(v), (n), __ATOMIC_RELEASE )
+
+EventQueue::EventQueue() {
+
+	_head = 0;
+	_tail = 0;
+
+	_overflows = 0;
+	_highWater = 0;
+}
+
+bool EventQueue::push( Device &device, knob_value_t newState, knob_value_t oldState,
+		knob_time_t time, knob_time_t now ) {
+
+	uint8_t head = _head,
+	        next = ( head + 1 ) & _MASK,
+	        fill;
+
+	if( next == _LOAD( _tail ) ) {
+		_overflows++;
+		return false;
+	}
+
+	Event &event = _events[ head ];
+
+	event.device = device._queueIndex;
+	event.newState = newState;
+	event.oldState = oldState;
+	event.time = time < 0xffffffff ? time : 0xffffffff;
+	event.now = now;
+
+	_STORE( _head, next );
+
+	fill = ( next - _LOAD( _tail ) ) & _MASK;
+	if( fill > _highWater ) _highWater = fill;
+
+	return true;
+}
+
+bool EventQueue::pop( Event &event ) {
+
+	uint8_t tail = _tail;
+
+	if( tail == _LOAD( _head ) ) return false;
+
+	event = _events[ tail ];
+
+	_STORE( _tail, ( tail + 1 ) & _MASK );
+
+	return true;
+}
+
+Device *EventQueue::device( uint8_t index ) {
+
+	return _devices.get( index );
+}
+
+int EventQueue::_enroll( Device &device ) {
+
+	Device *dev;
+	int index = 0;
+
+	for( Cursor<Device> it( _devices ); ( dev = it.next() ); index++ ) {
+
+		if( dev == &device ) return index;
+	}
+
+	return _devices.add( device ) ? index : -1;
+}
+
+int EventQueue::dispatch() {
+
+	Event event;
+	int count = 0;
+
+	// events are older than this
+	knob_time_t now = uptime();
+
+	while( pop( event ) ) {
+
+		_devices.get( event.device )->_dispatch( event.newState, event.oldState,
+				event.time, uptimeOf( event.now, now ) );
+		count++;
+	}
+
+	return count;
+}
+
+int EventQueue::fill() {
+
+	return ( _LOAD( _head ) - _LOAD( _tail ) ) & _MASK;
+}
+
+int EventQueue::capacity() {
+
+	// one slot is always kept free to tell full from empty
+	return KNOBS_EVENT_QUEUE_SIZE - 1;
+}
+
+uint16_t EventQueue::overflows() {
+
+	uint16_t overflows;
+
+	// two bytes on AVR. The producer may be an interrupt.
+	noInterrupts();
+	overflows = _overflows;
+	interrupts();
+
+	return overflows;
+}
+
+uint8_t EventQueue::highWater() {
+
+	return _highWater;
+}
+
+EventQueue& EventQueue::reset() {
+
+	noInterrupts();
+	_overflows = 0;
+	_highWater = 0;
+	interrupts();
+
+	return *this;
+}
+
+#pragma GCC diagnostic pop
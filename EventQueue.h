@@ -0,0 +1,97 @@
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+#include "Knob.h"
+
+#include <stdint.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+// Events which can be queued. Must be a power of 2, max. 128
+#ifndef KNOBS_EVENT_QUEUE_SIZE
+	#define KNOBS_EVENT_QUEUE_SIZE 32
+#endif
+
+// Devices which can use one queue. max. 255
+#ifndef KNOBS_EVENT_QUEUE_DEVICES
+	#define KNOBS_EVENT_QUEUE_DEVICES 16
+#endif
+
+namespace Knobs {
+
+	// One activation of a Device waiting for its handlers.
+	// 17 bytes on AVR. Times are kept in 32 bits: time is saturated and
+	// now is the clock counter. (see uptimeOf)
+	struct Event {
+		uint8_t device; // see EventQueue::device()
+		knob_value_t newState;
+		knob_value_t oldState;
+		uint32_t time;
+		uint32_t now;
+	};
+
+	// EventQueue: Decouples sampling from running the handlers.
+	//
+	// Devices using a queue only record their activations. The handlers
+	// are run later when dispatch() is called. So sampling can be done
+	// e.g. from a timer interrupt while slow callbacks run in the main loop.
+	//
+	// Wait free for exactly one producer (whoever calls the devices' loop)
+	// and one consumer (whoever calls dispatch).
+	// Note that Knobs are activated every loop, so the queue must hold at
+	// least one loop's worth of events of all devices using it.
+	class EventQueue {
+
+		friend class Device;
+
+		private:
+			Event _events[ KNOBS_EVENT_QUEUE_SIZE ];
+
+			// events refer to devices by index in here
+			Canister<Device, KNOBS_EVENT_QUEUE_DEVICES> _devices;
+
+			uint8_t _head; // written by producer
+			uint8_t _tail; // written by consumer
+
+			// statistics. written by producer
+			uint16_t _overflows;
+			uint8_t _highWater;
+
+			// index of device. -1 if there's no room
+			int _enroll( Device &device );
+
+		public:
+			EventQueue();
+
+			// add event of a Device using this queue. Returns false if
+			// full. Producer only.
+			bool push( Device &device, knob_value_t newState, knob_value_t oldState,
+					knob_time_t time, knob_time_t now );
+
+			// take oldest event. Returns false if empty. Consumer only.
+			bool pop( Event &event );
+			// device of event
+			Device *device( uint8_t index );
+
+			// run handlers of all waiting events. Consumer only.
+			// Returns amount of events dispatched.
+			int dispatch();
+
+			// events waiting
+			int fill();
+			int capacity();
+
+			// events dropped because the queue was full
+			uint16_t overflows();
+			// max. events waiting at the same time
+			uint8_t highWater();
+			// set statistics to zero
+			EventQueue& reset();
+	};
+}
+
+#pragma GCC diagnostic pop
+
+#endif
@@ -0,0 +1,121 @@
+#include "Keypad.h"
+
+#include <Arduino.h>
+
+#ifndef NOT_A_PORT
+	#define NOT_A_PORT 0
+#endif
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+using namespace Knobs;
+
+/*****************************************************************************
+*
+*   K E Y P A D
+*
+*****************************************************************************/
+
+Keypad::Keypad( const char *name, const pin_t *rows, uint8_t nrows,
+		const pin_t *cols, uint8_t ncols )
+		: KnobBank( name ) {
+
+	if( nrows > KNOBS_KEYPAD_LINES ) nrows = KNOBS_KEYPAD_LINES;
+	if( ncols > KNOBS_KEYPAD_LINES ) ncols = KNOBS_KEYPAD_LINES;
+	while( nrows * ncols > KNOBS_BANK_WIDTH ) nrows--;
+
+	_nrows = nrows;
+	_ncols = ncols;
+
+	for( uint8_t r = 0; r < nrows; r++ ) {
+
+		_rows[ r ] = rows[ r ];
+		pinMode( rows[ r ], INPUT );
+	}
+
+#ifdef portInputRegister
+	uint8_t port = ncols ? digitalPinToPort( cols[ 0 ] ) : NOT_A_PORT;
+#else
+	uint8_t port = NOT_A_PORT;
+#endif
+
+	for( uint8_t c = 0; c < ncols; c++ ) {
+
+		_cols[ c ] = cols[ c ];
+		pinMode( cols[ c ], INPUT_PULLUP );
+
+#ifdef portInputRegister
+		_colMask[ c ] = digitalPinToBitMask( cols[ c ] );
+		if( digitalPinToPort( cols[ c ] ) != port ) port = NOT_A_PORT;
+#endif
+	}
+
+	_colPort = port;
+
+	_scanTime = 0;
+	_scanTimeMax = 0;
+}
+
+// Columns' input register. Looked up every time: It may be
+// assembled on access. (e.g. host build)
+uint8_t Keypad::_readPort() {
+
+#ifdef portInputRegister
+	return *portInputRegister( _colPort );
+#else
+	return 0;
+#endif
+}
+
+bank_mask_t Keypad::_sample() {
+
+	uint32_t start = micros();
+
+	bank_mask_t raw = 0,
+	            bit = 1;
+
+	for( uint8_t r = 0; r < _nrows; r++ ) {
+
+		pin_t row = _rows[ r ];
+
+		digitalWrite( row, LOW );
+		pinMode( row, OUTPUT );
+
+		if( KNOBS_KEYPAD_SETTLE ) delayMicroseconds( KNOBS_KEYPAD_SETTLE );
+
+		if( _colPort != NOT_A_PORT ) {
+
+			uint8_t in = _readPort();
+
+			for( uint8_t c = 0; c < _ncols; c++, bit <<= 1 ) {
+				if( !( in & _colMask[ c ] ) ) raw |= bit;
+			}
+
+		} else {
+
+			for( uint8_t c = 0; c < _ncols; c++, bit <<= 1 ) {
+				if( !digitalRead( _cols[ c ] ) ) raw |= bit;
+			}
+		}
+
+		// float again so pressed keys don't short rows
+		pinMode( row, INPUT );
+	}
+
+	_scanTime = micros() - start;
+	if( _scanTime > _scanTimeMax ) _scanTimeMax = _scanTime;
+
+	return raw;
+}
+
+uint32_t Keypad::scanTime() {
+	return _scanTime;
+}
+
+uint32_t Keypad::scanTimeMax() {
+	return _scanTimeMax;
+}
+
+#pragma GCC diagnostic pop
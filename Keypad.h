@@ -0,0 +1,71 @@
+#ifndef KEYPAD_H
+#define KEYPAD_H
+
+#include "KnobBank.h"
+
+#include <stdint.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+// Max. amount of rows and of columns
+#ifndef KNOBS_KEYPAD_LINES
+	#define KNOBS_KEYPAD_LINES 8
+#endif
+// us to wait after a row is driven before columns are read
+#ifndef KNOBS_KEYPAD_SETTLE
+	#define KNOBS_KEYPAD_SETTLE 2
+#endif
+
+namespace Knobs {
+
+	// Keypad: A matrix of rows x columns keys.
+	//
+	// Rows are driven low one after the other, the other rows are left
+	// floating. Columns are inputs with pullup and read low for pressed
+	// keys. If all columns are on one port they are read with one port
+	// read per row.
+	//
+	// Keys are added with << row by row. So the Key in row r and
+	// column c is the (r*columns+c)-th one. They are debounced together
+	// like in a KnobBank and take the same handlers as a Knob.
+	class Keypad : public KnobBank {
+
+		private:
+
+			pin_t _rows[ KNOBS_KEYPAD_LINES ];
+			pin_t _cols[ KNOBS_KEYPAD_LINES ];
+			uint8_t _nrows, _ncols;
+
+			// port of all columns or NOT_A_PORT
+			uint8_t _colPort;
+			uint8_t _colMask[ KNOBS_KEYPAD_LINES ];
+
+			uint32_t _scanTime;
+			uint32_t _scanTimeMax;
+
+			uint8_t _readPort();
+
+		protected:
+
+			virtual bank_mask_t _sample();
+
+			// keys have no pins. Columns are read when they are scanned.
+			virtual void _attach( PortSnapshot *snapshot ) {}
+
+		public:
+
+			// rows*cols must not exceed KNOBS_BANK_WIDTH
+			Keypad( const char *name, const pin_t *rows, uint8_t nrows,
+					const pin_t *cols, uint8_t ncols );
+
+			// duration of last scan / longest scan in us
+			uint32_t scanTime();
+			uint32_t scanTimeMax();
+	};
+}
+
+#pragma GCC diagnostic pop
+
+#endif
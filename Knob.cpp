@@ -1,4 +1,5 @@
 #include "Knob.h"
+#include "EventQueue.h"
 
 #include <Arduino.h>
 
@@ -21,7 +22,27 @@ static inline knob_time_t MAX( knob_time_t v1, knob_time_t v2 ) {
 *
 *****************************************************************************/
 
-Device::Device( const char *name ) : _name( name ){}
+Device::Device( const char *name ) : _name( name ){
+
+	_slave = NULL;
+	_queue = NULL;
+	_queueIndex = 0;
+	_mute = false;
+	_now = 0;
+	_interest = 0;
+	_coalesce = false;
+	_woken = 0;
+	_wait = 0;
+
+#if KNOBS_TRACE
+	_traceId = TRACE_ENROLL( name );
+#endif
+}
+
+Device::~Device() {
+
+	Shelf<Handler, KNOBS_HANDLER_SLOTS>::release( _handlers );
+}
 
 Device& Device::enslave( Device &slave ){
 	slave.mute( true );
@@ -33,31 +54,174 @@ Device& Device::mute( bool mute ) {
 	return *this;
 }
 
+Device& Device::coalesce( bool on ) {
+	_coalesce = on;
+	_wait = 0;
+	return *this;
+}
+
+Device& Device::queue( EventQueue &queue ) {
+
+	int index = queue._enroll( *this );
+
+	if( index < 0 ) return *this;
+
+	_queue = &queue;
+	_queueIndex = index;
+
+	return *this;
+}
+Device& Device::unqueue() {
+	_queue = NULL;
+	return *this;
+}
+
 Device& Device::on( Handler &handler ){
 
-	_handlers.add( handler );
+	if( _handlers.fill() == _handlers.capacity() )
+			Shelf<Handler, KNOBS_HANDLER_SLOTS>::grow( _handlers );
+
+	if( _handlers.add( handler ) ) _interest |= handler.interest();
 
 	return *this;
 }
 
+int Device::handlerOverflow() {
+	return _handlers.overflow();
+}
+
+void Device::_interests( uint8_t what ) {
+	_interest |= what;
+}
+
+bool Device::_interested( uint8_t what ) {
+
+	return ( _interest & what ) || ( _slave && _slave->_interested( what ) );
+}
+
+bool Device::handlers( Handler **storage, int capacity ) {
+
+	return Shelf<Handler, KNOBS_HANDLER_SLOTS>::reserve( _handlers, storage, capacity );
+}
+
 const char* Device::name() {
 	return _name;
 }
 
+knob_time_t Device::now() {
+	return _now;
+}
+
+#if KNOBS_PROFILE
+TimeStats &Device::loopStats() {
+	return _loopStats;
+}
+TimeStats &Device::dispatchStats() {
+	return _dispatchStats;
+}
+#endif
+
+void Device::loop( knob_time_t now ) {
+	loop();
+}
+
+knob_time_t Device::due( knob_time_t now ) {
+	return 0;
+}
+
+knob_time_t Device::_handlersDue( knob_value_t state, knob_time_t time ) {
+
+	Handler *handler;
+	knob_time_t due, min = KNOB_TIME_NEVER;
+
+	for( Cursor<Handler> it( _handlers ); ( handler = it.next() ); ) {
+
+		due = handler->due( state, time );
+		if( due < min ) min = due;
+	}
+
+	return min;
+}
+
+knob_time_t Device::_due( knob_value_t state, knob_time_t time ) {
+
+	knob_time_t due, min = _handlersDue( state, time );
+
+	if( _slave ) {
+		due = _slave->_due( state, time );
+		if( due < min ) min = due;
+	}
+
+	return min;
+}
+
 void Device::_activate( knob_value_t newState, knob_value_t oldState, knob_time_t time ) {
 
+	_activate( newState, oldState, time, uptime() );
+}
+
+void Device::_activate( knob_value_t newState, knob_value_t oldState, knob_time_t time,
+		knob_time_t now ) {
+
+	// nobody would do anything
+	if( !_interested( interestOf( newState, oldState ) ) ) return;
+
+	// (not while queued: _due() would look at handlers the consumer is running)
+	bool coalesce = _coalesce && !_queue;
+
+	if( coalesce ) {
+
+		// nothing changed and nobody due yet. (Time running backwards
+		// means the clock wrapped.)
+		if( newState == oldState && now >= _woken && now - _woken < _wait ) return;
+
+		_woken = now;
+	}
+
+	if( newState != oldState ) TRACE( TRACE_ACTIVATE, _traceId, newState, oldState );
+
+	PROFILE_START( start );
+
+	if( _queue ) {
+		_queue->push( *this, newState, oldState, time, now );
+	} else {
+		_dispatch( newState, oldState, time, now );
+	}
+
+	PROFILE_ADD( _dispatchStats, start );
+
+	// handlers are due relative to the time the state is unchanged
+	if( coalesce ) _wait = _due( newState, time );
+}
+
+void Device::_dispatch( knob_value_t newState, knob_value_t oldState, knob_time_t time,
+		knob_time_t now ) {
+
+	_now = now;
+
+	_handle( newState, oldState, time );
+
+	if( _slave ) _slave->_dispatch( newState, oldState, time, now );
+}
+
+bool Device::_handle( knob_value_t newState, knob_value_t oldState, knob_time_t time ) {
+
 	Handler *handler;
 	
 	bool cont;
+
+	uint8_t what = interestOf( newState, oldState );
 	
-	for( handler = _handlers.first(); handler; handler = _handlers.next() ) {
+	for( Cursor<Handler> it( _handlers ); ( handler = it.next() ); ) {
+
+		if( !( handler->_interest & what ) ) continue;
 
 		cont = handler->handle( *this, newState, oldState, time );
 
-		if( !cont ) break;
+		if( !cont ) return false;
 	}
 
-	if( _slave ) _slave->_activate( newState, oldState, time );
+	return true;
 }
 
 
@@ -70,6 +234,8 @@ void Device::_activate( knob_value_t newState, knob_value_t oldState, knob_time_
 BooleanDevice::BooleanDevice( const char *name, pin_t pin) : Device( name ), _pin( pin ) {
 
 	_invert = false;
+	_sample = NULL;
+	_mask = 0;
 }
 
 BooleanDevice& BooleanDevice::pullup( bool on ) {
@@ -86,11 +252,19 @@ BooleanDevice& BooleanDevice::invert( bool on ) {
 }
 bool BooleanDevice::_read() {
 
-	bool val = digitalRead( _pin );
+	bool val = _sample ? ( *_sample & _mask ) : digitalRead( _pin );
 
 	return _invert ? !val : val;
 }
 
+void BooleanDevice::_attach( PortSnapshot *snapshot ) {
+
+	_sample = snapshot ? snapshot->use( _pin ) : NULL;
+#ifdef portInputRegister
+	_mask = digitalPinToBitMask( _pin );
+#endif
+}
+
 pin_t BooleanDevice::pin() {
 	
 	return _pin;
@@ -110,10 +284,17 @@ Knob::Knob( const char *name, uint8_t pin )
 	_value = 0;
 
 	_lastTime = 0;
+	_timeUnchanged = 0;
 
 	_timeDebounce = TIME_DEBOUNCE;
 	_countDebounce = 0;
 
+	_irq = -1;
+	_raw = 0;
+	_rawTime = 0;
+	_burst = 0;
+	_since = 0;
+
 	pinMode( pin, INPUT );
 }
 
@@ -124,19 +305,28 @@ knob_value_t Knob::value() {
 
 void Knob::loop() {
 
+	loop( uptime() );
+}
+
+void Knob::loop( knob_time_t now ) {
+
 	if( _mute ) return;
 
-	knob_time_t now = millis(),
-	       delta = _lastTime < now ?
-		   		now - _lastTime :
-				(((knob_time_t)-1) - _lastTime) + now +1; // compensate for overrun every 50 days
-	       ;
+	if( _irq >= 0 ) {
+		_loopEdges( now );
+		return;
+	}
+
+	knob_time_t delta = now - _lastTime;
 
+	// the time since the last loop belongs to the level read then. The
+	// one read now starts counting. (A glitch after an idle isn't taken
+	// as debounced.)
 	knob_value_t oldValue = _value,
-	        value = _read()
+	        value = _raw
 	        ;
 
-
+	_raw = _read();
 	_lastTime = now;
 
 	if( value ) {
@@ -147,7 +337,7 @@ void Knob::loop() {
 		_countDebounce = _countDebounce > delta ? _countDebounce-delta : 0;
 	}
 
-	if( _countDebounce == 0 || _countDebounce == _timeDebounce ) {
+	if( value ? _countDebounce == _timeDebounce : _countDebounce == 0 ) {
 
 		if( value != _value )
 				_timeUnchanged = 0;
@@ -156,7 +346,7 @@ void Knob::loop() {
 
 		_value = value;
 
-		_activate( value, oldValue, _timeUnchanged );
+		_activate( value, oldValue, _timeUnchanged, now );
 	}
 }
 
@@ -165,6 +355,246 @@ Knob& Knob::debounce( knob_time_t time ) {
 	return *this;
 }
 
+/*
+ * Interrupt mode
+ *
+ * An ISR can't take arguments so there is a fixed amount of
+ * trampolines, each with its own slot and EdgeBuffer.
+ */
+
+static Knob *_irqKnobs[ KNOBS_INTERRUPTS ];
+static EdgeBuffer _irqEdges[ KNOBS_INTERRUPTS ];
+
+template <int N>
+static void _irqTrampoline() {
+	_irqKnobs[ N ]->edge();
+}
+
+typedef void (*_irq_f)();
+
+#if KNOBS_INTERRUPTS < 1 || KNOBS_INTERRUPTS > 8
+	#error "KNOBS_INTERRUPTS must be 1..8"
+#endif
+
+static const _irq_f _irqTrampolines[ KNOBS_INTERRUPTS ] = {
+	_irqTrampoline<0>
+#if KNOBS_INTERRUPTS > 1
+	, _irqTrampoline<1>
+#endif
+#if KNOBS_INTERRUPTS > 2
+	, _irqTrampoline<2>
+#endif
+#if KNOBS_INTERRUPTS > 3
+	, _irqTrampoline<3>
+#endif
+#if KNOBS_INTERRUPTS > 4
+	, _irqTrampoline<4>
+#endif
+#if KNOBS_INTERRUPTS > 5
+	, _irqTrampoline<5>
+#endif
+#if KNOBS_INTERRUPTS > 6
+	, _irqTrampoline<6>
+#endif
+#if KNOBS_INTERRUPTS > 7
+	, _irqTrampoline<7>
+#endif
+};
+
+Knob& Knob::interrupt( bool on ) {
+
+	int irq = digitalPinToInterrupt( _pin );
+
+	if( on && _irq < 0 ) {
+
+		for( int8_t slot = 0; slot < KNOBS_INTERRUPTS; slot++ ) {
+
+			if( _irqKnobs[ slot ] ) continue;
+
+			_irqEdges[ slot ].clear();
+			_irqKnobs[ slot ] = this;
+			_irq = slot;
+
+			// start from current state
+			_raw = _value;
+			_rawTime = _burst = _since = uptime() - _timeUnchanged;
+
+			if( irq != NOT_AN_INTERRUPT )
+					attachInterrupt( irq, _irqTrampolines[ slot ], CHANGE );
+			break;
+		}
+
+	} else if( !on && _irq >= 0 ) {
+
+		if( irq != NOT_AN_INTERRUPT ) detachInterrupt( irq );
+
+		_irqKnobs[ _irq ] = NULL;
+		_irq = -1;
+
+		_lastTime = uptime();
+		_countDebounce = _value ? _timeDebounce : 0;
+		_raw = _value;
+	}
+
+	return *this;
+}
+
+bool Knob::interrupted() {
+	return _irq >= 0;
+}
+
+void Knob::edge() {
+
+	if( _irq < 0 ) return;
+
+	bool val = digitalRead( _pin );
+
+	_irqEdges[ _irq ].push( clockRead(), _invert ? !val : val );
+}
+
+void Knob::_loopEdges( knob_time_t now ) {
+
+	EdgeBuffer &edges = _irqEdges[ _irq ];
+	EdgeBuffer::Edge edge;
+
+	while( edges.pop( edge ) ) {
+
+		_edge( edge.level, uptimeOf( edge.time, now ) );
+	}
+
+	// lost edges. Resync with the pin
+	if( edges.overrun() ) {
+
+		bool val = digitalRead( _pin );
+
+		_edge( _invert ? !val : val, now );
+	}
+
+	if( _raw != _value && now - _rawTime >= _timeDebounce ) _commit();
+
+	if( _raw == _value ) {
+
+		_activate( _value, _value, now - _since, now );
+	}
+}
+
+void Knob::_edge( knob_value_t level, knob_time_t time ) {
+
+	if( level == _raw ) return;
+
+	// level before this edge was stable long enough. So this edge
+	// starts a new burst of bouncing.
+	if( time - _rawTime >= _timeDebounce ) {
+
+		if( _raw != _value ) _commit();
+
+		_burst = time;
+	}
+
+	_raw = level;
+	_rawTime = time;
+}
+
+// Takes over the pending state. Handlers see the time of the first
+// edge of the burst which led to it.
+void Knob::_commit() {
+
+	knob_value_t oldValue = _value;
+
+	_value = _raw;
+	_since = _burst;
+	_timeUnchanged = 0;
+
+	_activate( _value, oldValue, 0, _since );
+}
+
+knob_time_t Knob::due( knob_time_t now ) {
+
+	if( _mute ) return KNOB_TIME_NEVER;
+
+	if( _irq >= 0 ) {
+
+		// edges not looked at yet
+		if( _irqEdges[ _irq ].waiting() ) return 0;
+
+		// still bouncing
+		if( _raw != _value ) return MAX( 0, _timeDebounce - ( now - _rawTime ) );
+
+		return MAX( 0, _due( _value, now - _since ) );
+	}
+
+	// still debouncing towards the level read last
+	if( _raw ? _countDebounce != _timeDebounce : _countDebounce != 0 )
+			return MAX( 0, ( _raw ? _timeDebounce - _countDebounce : _countDebounce )
+					- ( now - _lastTime ) );
+
+	return MAX( 0, _due( _value, _timeUnchanged + now - _lastTime ) );
+}
+
+
+/*****************************************************************************
+*
+*   E D G E  B U F F E R
+*
+*****************************************************************************/
+
+// see EventQueue
+#define _LOAD( v ) __atomic_load_n( &(v), __ATOMIC_ACQUIRE )
+#define _STORE( v, n ) __atomic_store_n( &(v), (n), __ATOMIC_RELEASE )
+
+EdgeBuffer::EdgeBuffer() {
+
+	clear();
+}
+
+void EdgeBuffer::push( uint32_t time, bool level ) {
+
+	uint8_t head = _head,
+	        next = ( head + 1 ) & ( KNOBS_EDGE_BUFFER - 1 );
+
+	if( next == _LOAD( _tail ) ) {
+		_STORE( _overrun, true );
+		return;
+	}
+
+	_edges[ head ].time = time;
+	_edges[ head ].level = level;
+
+	_STORE( _head, next );
+}
+
+bool EdgeBuffer::pop( Edge &edge ) {
+
+	uint8_t tail = _tail;
+
+	if( tail == _LOAD( _head ) ) return false;
+
+	edge.time = _edges[ tail ].time;
+	edge.level = _edges[ tail ].level;
+
+	_STORE( _tail, ( tail + 1 ) & ( KNOBS_EDGE_BUFFER - 1 ) );
+
+	return true;
+}
+
+bool EdgeBuffer::waiting() {
+
+	return _tail != _LOAD( _head );
+}
+
+bool EdgeBuffer::overrun() {
+
+	// an edge may be lost meanwhile
+	return __atomic_exchange_n( &_overrun, false, __ATOMIC_ACQ_REL );
+}
+
+void EdgeBuffer::clear() {
+
+	_head = 0;
+	_tail = 0;
+	_overrun = false;
+}
+
 
 /*****************************************************************************
 *
@@ -173,16 +603,31 @@ Knob& Knob::debounce( knob_time_t time ) {
 *****************************************************************************/
 
 Handler::Handler( HandlerType type, callback_t callback ) 
-		: _cb( callback ), _cbm( NULL ), type( type ) {}
+		: _cb( callback ), _cbm( NULL ), _interest( IN_ALL ), type( type ) {}
 Handler::Handler( HandlerType type, minimal_callback_t callback )
-		: _cb( NULL ), _cbm( callback ), type( type ) {}
+		: _cb( NULL ), _cbm( callback ), _interest( IN_ALL ), type( type ) {}
+
+knob_time_t Handler::due( knob_value_t state, knob_time_t time ) {
+
+	return KNOB_TIME_NEVER;
+}
 
 bool Handler::_callback( Device &dev, knob_value_t newState, knob_value_t oldState, knob_time_t count ) {
 
+	bool cont;
+
+	TRACE( TRACE_FIRE, dev._traceId, newState, type );
+
+	PROFILE_START( start );
+
 	if( _cbm ) {
-		return _cbm( newState );
+		cont = _cbm( newState );
 	//} else if( _cbs ) return _cbs( newState, oldState, count );
-	} else return _cb( dev, *this, newState, oldState, count );
+	} else cont = _cb( dev, *this, newState, oldState, count );
+
+	PROFILE_ADD( _stats, start );
+
+	return cont;
 }
 
 
@@ -196,10 +641,20 @@ bool Always::handle( Device &dev, knob_value_t newState, knob_value_t oldState,
 	return _callback( dev, newState, oldState, time );
 }
 
+knob_time_t Always::due( knob_value_t state, knob_time_t time ) {
+
+	return 0;
+}
+
 // == Push ==
 
-Push::Push( callback_t callback ) : Handler( HT_PUSH, callback ) {}
-Push::Push( minimal_callback_t callback ) : Handler( HT_PUSH, callback ) {}
+Push::Push( callback_t callback ) : Handler( HT_PUSH, callback ) {
+	// states may be negative: off/on is checked in handle()
+	_interest = IN_CHANGE;
+}
+Push::Push( minimal_callback_t callback ) : Handler( HT_PUSH, callback ) {
+	_interest = IN_CHANGE;
+}
 
 bool Push::handle( Device &dev, knob_value_t newState, knob_value_t oldState, knob_time_t time ) {
 
@@ -212,8 +667,13 @@ bool Push::handle( Device &dev, knob_value_t newState, knob_value_t oldState, kn
 
 // == Release ==
 
-Release::Release( callback_t callback ) : Handler( HT_RELEASE, callback ) {}
-Release::Release( minimal_callback_t callback ) : Handler( HT_RELEASE, callback ) {}
+Release::Release( callback_t callback ) : Handler( HT_RELEASE, callback ) {
+	// states may be negative: off/on is checked in handle()
+	_interest = IN_CHANGE;
+}
+Release::Release( minimal_callback_t callback ) : Handler( HT_RELEASE, callback ) {
+	_interest = IN_CHANGE;
+}
 
 bool Release::handle( Device &dev, knob_value_t newState, knob_value_t oldState, knob_time_t time ) {
 
@@ -226,8 +686,12 @@ bool Release::handle( Device &dev, knob_value_t newState, knob_value_t oldState,
 
 // == Toggle ==
 
-Toggle::Toggle( callback_t callback ) : Handler( HT_TOGGLE, callback ) {}
-Toggle::Toggle( minimal_callback_t callback ) : Handler( HT_TOGGLE, callback ) {}
+Toggle::Toggle( callback_t callback ) : Handler( HT_TOGGLE, callback ) {
+	_interest = IN_CHANGE;
+}
+Toggle::Toggle( minimal_callback_t callback ) : Handler( HT_TOGGLE, callback ) {
+	_interest = IN_CHANGE;
+}
 
 bool Toggle::handle( Device &dev, knob_value_t newState, knob_value_t oldState, knob_time_t time ) {
 
@@ -241,9 +705,15 @@ bool Toggle::handle( Device &dev, knob_value_t newState, knob_value_t oldState,
 // (callback regularily if active, deactove one time)
 
 Transport::Transport( callback_t callback, knob_time_t periode ) 
-		: Handler( HT_TRANSPORT, callback ), _periode( periode ){}
+		: Handler( HT_TRANSPORT, callback ), _lastTime( 0 ), _periode( periode ){
+
+	_interest = IN_CHANGE | IN_HIGH;
+}
 Transport::Transport( minimal_callback_t callback, knob_time_t periode ) 
-		: Handler( HT_TRANSPORT, callback ), _periode( periode ){}
+		: Handler( HT_TRANSPORT, callback ), _lastTime( 0 ), _periode( periode ){
+
+	_interest = IN_CHANGE | IN_HIGH;
+}
 
 bool Transport::handle( Device &dev, knob_value_t newState, knob_value_t oldState, knob_time_t time ) {
 
@@ -264,30 +734,53 @@ bool Transport::handle( Device &dev, knob_value_t newState, knob_value_t oldStat
 	return true;
 }
 
+knob_time_t Transport::due( knob_value_t state, knob_time_t time ) {
+
+	if( !state ) return KNOB_TIME_NEVER;
+
+	return MAX( 0, _periode + 1 - ( time - _lastTime ) );
+}
+
 
 // == Click ==
 
 Click::Click( HandlerType type, callback_t callback, knob_time_t maxTimeClick )
 		: Handler( type, callback )
 		, _maxTimeClick( maxTimeClick )
-		{}
+		, _timeStart( 0 )
+		{
+
+	_interest = IN_CHANGE;
+}
 Click::Click( HandlerType type, minimal_callback_t callback, knob_time_t maxTimeClick )
 		: Handler( type, callback )
 		, _maxTimeClick( maxTimeClick )
-		{}
+		, _timeStart( 0 )
+		{
+
+	_interest = IN_CHANGE;
+}
 
 Click::Click( callback_t callback, knob_time_t maxTimeClick )
 		: Handler( HT_CLICK, callback )
 		, _maxTimeClick( maxTimeClick )
-		{}
+		, _timeStart( 0 )
+		{
+
+	_interest = IN_CHANGE;
+}
 Click::Click( minimal_callback_t callback, knob_time_t maxTimeClick )
 		: Handler( HT_CLICK, callback )
 		, _maxTimeClick( maxTimeClick )
-		{}
+		, _timeStart( 0 )
+		{
+
+	_interest = IN_CHANGE;
+}
 
 bool Click::handle( Device &dev, knob_value_t newState, knob_value_t oldState, knob_time_t time ) {
 
-	knob_time_t now = millis();
+	knob_time_t now = dev.now();
 
 	if( newState != oldState ) {
 
@@ -335,7 +828,7 @@ DoubleClick::DoubleClick( minimal_callback_t callback,
 
 bool DoubleClick::_callback( Device &dev, knob_value_t newValue, knob_value_t oldValue, knob_time_t count ) {
 
-	knob_time_t now = millis(),
+	knob_time_t now = dev.now(),
 	       delta = now-_timeStartSequence
 		   ;
 
@@ -393,7 +886,7 @@ MultiClick::MultiClick( minimal_callback_t callback, knob_time_t maxTimeClick, k
 
 bool MultiClick::_callback( Device &dev, knob_value_t newValue, knob_value_t oldValue, knob_time_t count ) {
 
-	knob_time_t now = millis(),
+	knob_time_t now = dev.now(),
 	       delta = now-_timeLastClick
 		   ;
 
@@ -424,6 +917,7 @@ Hold::Hold( callback_t callback, knob_time_t time )
 		
 	_continues = false;
 	_hasSent = false;
+	_interest = IN_CHANGE | IN_HIGH;
 }
 Hold::Hold( minimal_callback_t callback, knob_time_t time ) 
 		: Handler( HT_HOLD, callback ) 
@@ -432,6 +926,7 @@ Hold::Hold( minimal_callback_t callback, knob_time_t time )
 		
 	_continues = false;
 	_hasSent = false;
+	_interest = IN_CHANGE | IN_HIGH;
 }
 
 bool Hold::handle( Device &dev, knob_value_t newState, knob_value_t oldState, knob_time_t time ) {
@@ -459,6 +954,13 @@ bool Hold::handle( Device &dev, knob_value_t newState, knob_value_t oldState, kn
 	return true;
 }
 
+knob_time_t Hold::due( knob_value_t state, knob_time_t time ) {
+
+	if( !state || ( _hasSent && !_continues ) ) return KNOB_TIME_NEVER;
+
+	return MAX( 0, _timeHold - time );
+}
+
 Hold& Hold::continues( bool on ) {
 
 	_continues = on;
@@ -473,12 +975,18 @@ Hold& Hold::continues( bool on ) {
 Over::Over( callback_t callback, knob_value_t val ) 
 		: Handler( HT_OVER, callback ) 
 		, _val( val )
-		{ }
+		{
+
+	_interest = IN_RISE;
+}
 
 Over::Over( minimal_callback_t callback, knob_value_t val ) 
 		: Handler( HT_OVER, callback ) 
 		, _val( val )
-		{ }
+		{
+
+	_interest = IN_RISE;
+}
 
 bool Over::handle( Device &dev,
 		knob_value_t newState, knob_value_t oldState, knob_time_t time ){
@@ -486,7 +994,7 @@ bool Over::handle( Device &dev,
 	if( oldState < _val && newState >= _val )
 			return _callback( dev, newState, oldState, time );
 
-	return false;
+	return true;
 
 }
 
@@ -496,12 +1004,18 @@ bool Over::handle( Device &dev,
 Under::Under( callback_t callback, knob_value_t val ) 
 		: Handler( HT_UNDER, callback ) 
 		, _val( val )
-		{ }
+		{
+
+	_interest = IN_FALL;
+}
 
 Under::Under( minimal_callback_t callback, knob_value_t val ) 
 		: Handler( HT_UNDER, callback ) 
 		, _val( val )
-		{ }
+		{
+
+	_interest = IN_FALL;
+}
 
 bool Under::handle( Device &dev,
 		knob_value_t newState, knob_value_t oldState, knob_time_t time ){
@@ -509,7 +1023,7 @@ bool Under::handle( Device &dev,
 	if( oldState > _val && newState <= _val )
 			return _callback( dev, newState, oldState, time );
 
-	return false;
+	return true;
 
 }
 
@@ -520,14 +1034,20 @@ Hysteresis::Hysteresis( callback_t callback,
 		: Handler( HT_OVER, callback ) 
 		, _upper_bound( upper_bound )
 		, _lower_bound( lower_bound )
-		{ }
+		{
+
+	_interest = IN_CHANGE;
+}
 
 Hysteresis::Hysteresis( minimal_callback_t callback,
 		knob_value_t lower_bound, knob_value_t upper_bound ) 
 		: Handler( HT_OVER, callback ) 
 		, _upper_bound( upper_bound )
 		, _lower_bound( lower_bound )
-		{ }
+		{
+
+	_interest = IN_CHANGE;
+}
 
 bool Hysteresis::handle( Device &dev,
 		knob_value_t newState, knob_value_t oldState, knob_time_t time ){
@@ -537,7 +1057,47 @@ bool Hysteresis::handle( Device &dev,
 	if( oldState > _lower_bound && newState <= _lower_bound )
 			return _callback( dev, newState, oldState, time );
 
-	return false;
+	return true;
+}
+
+
+/*****************************************************************************
+*
+*   P O R T  S N A P S H O T
+*
+*****************************************************************************/
+
+PortSnapshot::PortSnapshot() {
+
+	_used = 0;
+	memset( _value, 0, sizeof( _value ) );
+}
+
+const uint8_t *PortSnapshot::use( pin_t pin ) {
+
+#ifdef portInputRegister
+	uint8_t port = digitalPinToPort( pin );
+
+	if( port == NOT_A_PORT || port >= KNOBS_PORTS ) return NULL;
+
+	_used |= 1 << port;
+
+	return &_value[ port ];
+#else
+	return NULL;
+#endif
+}
+
+void PortSnapshot::sample() {
+
+#ifdef portInputRegister
+	uint16_t used = _used;
+
+	for( uint8_t port = 0; used; port++, used >>= 1 ) {
+
+		if( used & 1 ) _value[ port ] = *portInputRegister( port );
+	}
+#endif
 }
 
 
@@ -545,65 +1105,246 @@ bool Hysteresis::handle( Device &dev,
  * ## P A N E L ##
  */
 
+void Panel::_init() {
+
+	_sampling = false;
+	_queue = NULL;
+
+#if KNOBS_PROFILE
+	_deadline = 0;
+	_overruns = 0;
+#endif
+}
+
 Panel::Panel( const char *name )
-		: _name( name ){}
+		: _name( name ){
+	_init();
+}
 
 Panel::Panel( const char *name, Device &k1 )
 		: _name( name ){
+	_init();
 	*this << k1;
 }
 Panel::Panel( const char *name, Device &k1, Device &k2 )
 		: _name( name ){
+	_init();
 	*this << k2 << k1;
 }
 Panel::Panel( const char *name, Device &k1, Device &k2, Device &k3 )
 		: _name( name ){
+	_init();
 	*this << k3 << k2 << k1;
 }
 Panel::Panel( const char *name, Device &k1, Device &k2, Device &k3, Device &k4 )
 		: _name( name ){
+	_init();
 	*this << k4 << k3 << k2 << k1;
 }
 Panel::Panel( const char *name, Device &k1, Device &k2, Device &k3, Device &k4, 
 		Device &k5 )
 		: _name( name ){
+	_init();
 	*this << k5 << k4 << k3 << k2 << k1;
 }
 Panel::Panel( const char *name, Device &k1, Device &k2, Device &k3, Device &k4,
 		Device &k5, Device &k6 )
 		: _name( name ){
+	_init();
 	*this << k6 << k5 << k4 << k3 << k2 << k1;
 }
 Panel::Panel( const char *name, Device &k1, Device &k2, Device &k3, Device &k4,
 		Device &k5, Device &k6, Device &k7 )
 		: _name( name ){
+	_init();
 	*this << k7 << k6 << k5 << k4 << k3 << k2 << k1;
 }
 Panel::Panel( const char *name, Device &k1, Device &k2, Device &k3, Device &k4,
 		Device &k5, Device &k6, Device &k7, Device &k8 )
-		: _name( name ) {
+		: _name( name ){
+	_init();
 	*this << k8 << k7 << k6 << k5 << k4 << k3 << k2 << k1;
 }
 
 Panel& Panel::operator <<( Device &dev ) {
 
 	_devices.add( dev );
+	_index.invalidate();
+
+	if( _sampling ) dev._attach( &_snapshot );
+	if( _queue ) dev.queue( *_queue );
+
+	return *this;
+}
+
+bool Panel::devices( Device **storage, int capacity ) {
+
+	_index.invalidate();
+	return _devices.reserve( storage, capacity );
+}
+
+Device* Panel::find( const char *query ) {
+
+	return _index.find( _devices, query );
+}
+
+Panel& Panel::queue( EventQueue &queue ) {
+
+	Device *dev;
+
+	_queue = &queue;
+
+	for( Cursor<Device> it( _devices ); ( dev = it.next() ); ) {
+
+		dev->queue( queue );
+	}
+
+	return *this;
+}
+
+Panel& Panel::snapshot( bool on ) {
+
+	Device *dev;
+
+	_sampling = on;
+
+	for( Cursor<Device> it( _devices ); ( dev = it.next() ); ) {
+
+		dev->_attach( on ? &_snapshot : NULL );
+	}
 
 	return *this;
 }
 
 void Panel::loop() {
 
+	loop( uptime() );
+}
+
+void Panel::loop( knob_time_t now ) {
+
+	Device *dev;
+
+	PROFILE_START( begin );
+
+	if( _sampling ) _snapshot.sample();
+
+	for( Cursor<Device> it( _devices ); ( dev = it.next() ); ) {
+
+		PROFILE_START( start );
+
+		dev->loop( now );
+
+		PROFILE_ADD( dev->_loopStats, start );
+	}
+
+#if KNOBS_PROFILE
+	uint32_t elapsed = micros() - begin;
+
+	_stats.add( elapsed );
+	if( _deadline && elapsed > _deadline ) _overruns++;
+#endif
+}
+
+knob_time_t Panel::due() {
+
 	Device *dev;
+	knob_time_t now = uptime(),
+	            due, min = KNOB_TIME_NEVER;
 
-	for( dev = _devices.first(); dev; dev = _devices.next() ) {
+	for( Cursor<Device> it( _devices ); ( dev = it.next() ); ) {
 
-		dev->loop();
+		due = dev->due( now );
+		if( due < min ) min = due;
 	}
+
+	return min;
 }
 
 const char * Panel::name() {
 	return _name;
 }
 
+#if KNOBS_PROFILE
+TimeStats &Panel::stats() {
+	return _stats;
+}
+
+Panel& Panel::deadline( uint32_t us ) {
+	_deadline = us;
+	return *this;
+}
+
+uint32_t Panel::overruns() {
+	return _overruns;
+}
+
+Device *Panel::slowest() {
+
+	Device *dev, *slowest = NULL;
+
+	for( Cursor<Device> it( _devices ); ( dev = it.next() ); ) {
+
+		if( !slowest || dev->_loopStats.max > slowest->_loopStats.max ) slowest = dev;
+	}
+
+	return slowest;
+}
+
+Panel& Panel::resetStats() {
+
+	Device *dev;
+	Handler *handler;
+
+	_stats.reset();
+	_overruns = 0;
+
+	for( Cursor<Device> it( _devices ); ( dev = it.next() ); ) {
+
+		dev->_loopStats.reset();
+		dev->_dispatchStats.reset();
+
+		for( Cursor<Handler> hit( dev->_handlers ); ( handler = hit.next() ); ) {
+			handler->_stats.reset();
+		}
+	}
+
+	return *this;
+}
+
+Panel& Panel::printStats() {
+
+	Device *dev;
+	Handler *handler;
+
+	Serial.print( _name );
+	Serial.print( ": " );
+	_stats.print();
+	Serial.print( " overruns=" );
+	Serial.println( _overruns );
+
+	for( Cursor<Device> it( _devices ); ( dev = it.next() ); ) {
+
+		Serial.print( "  " );
+		Serial.print( dev->name() );
+		Serial.print( " loop " );
+		dev->_loopStats.print();
+		Serial.print( " dispatch " );
+		dev->_dispatchStats.print();
+		Serial.println();
+
+		for( Cursor<Handler> hit( dev->_handlers ); ( handler = hit.next() ); ) {
+
+			Serial.print( "    handler " );
+			Serial.print( (int)handler->type );
+			Serial.print( " " );
+			handler->_stats.print();
+			Serial.println();
+		}
+	}
+
+	return *this;
+}
+#endif
+
 #pragma GCC diagnostic pop
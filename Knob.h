@@ -9,14 +9,71 @@
 #pragma GCC diagnostic error "-Wreturn-type"
 
 #include "knobs_common.h"
+#include "Clock.h"
 #include "Canister.h"
+#include "Pool.h"
+#include "NameIndex.h"
+#include "Trace.h"
+#include "Profile.h"
 
+// Handler slots built into every Device.
 #ifndef KNOBS_HANDLER_CANISTER_SIZE
 	#define KNOBS_HANDLER_CANISTER_SIZE 5
 #endif
+// Slots shared by all Devices for the handlers which don't fit into
+// their own. With KNOBS_HANDLER_CANISTER_SIZE 0 all handlers go there,
+// so each Device takes as many as it uses.
+#ifndef KNOBS_HANDLER_SLOTS
+	#define KNOBS_HANDLER_SLOTS 8
+#endif
 #ifndef KNOBS_PANEL_CANISTER_SIZE
 	#define KNOBS_PANEL_CANISTER_SIZE 20
 #endif
+// Handlers of each type which can be created by onXXX. See Pool.h
+#ifndef KNOBS_POOL_Always
+	#define KNOBS_POOL_Always KNOBS_POOL_SIZE
+#endif
+#ifndef KNOBS_POOL_Push
+	#define KNOBS_POOL_Push KNOBS_POOL_SIZE
+#endif
+#ifndef KNOBS_POOL_Release
+	#define KNOBS_POOL_Release KNOBS_POOL_SIZE
+#endif
+#ifndef KNOBS_POOL_Toggle
+	#define KNOBS_POOL_Toggle KNOBS_POOL_SIZE
+#endif
+#ifndef KNOBS_POOL_Click
+	#define KNOBS_POOL_Click KNOBS_POOL_SIZE
+#endif
+#ifndef KNOBS_POOL_DoubleClick
+	#define KNOBS_POOL_DoubleClick KNOBS_POOL_SIZE
+#endif
+#ifndef KNOBS_POOL_MultiClick
+	#define KNOBS_POOL_MultiClick KNOBS_POOL_SIZE
+#endif
+#ifndef KNOBS_POOL_Hold
+	#define KNOBS_POOL_Hold KNOBS_POOL_SIZE
+#endif
+#ifndef KNOBS_POOL_Over
+	#define KNOBS_POOL_Over KNOBS_POOL_SIZE
+#endif
+#ifndef KNOBS_POOL_Under
+	#define KNOBS_POOL_Under KNOBS_POOL_SIZE
+#endif
+#ifndef KNOBS_POOL_Hysteresis
+	#define KNOBS_POOL_Hysteresis KNOBS_POOL_SIZE
+#endif
+#ifndef KNOBS_POOL_Transport
+	#define KNOBS_POOL_Transport KNOBS_POOL_SIZE
+#endif
+// Amount of Knobs which can be operated by interrupt
+#ifndef KNOBS_INTERRUPTS
+	#define KNOBS_INTERRUPTS 4
+#endif
+// Edges buffered per interrupt operated Knob. Must be a power of 2.
+#ifndef KNOBS_EDGE_BUFFER
+	#define KNOBS_EDGE_BUFFER 8
+#endif
 
 
 // Everything is put in namespace Knobs in order to avoid conflicts
@@ -28,6 +85,8 @@ namespace Knobs {
 	class Device;
 	class Handler;
 	class Panel;
+	class PortSnapshot;
+	class EventQueue;
 
 	typedef bool (*minimal_callback_t)( knob_value_t val );
 	typedef bool (*callback_t)( Device &dev, Handler &handler,
@@ -51,6 +110,26 @@ namespace Knobs {
 		HT_TRANSPORT=99
 	};
 
+	// What kind of activation a Handler wants to see.
+	// Devices don't call handlers for activations they aren't interested in.
+	enum Interest {
+		IN_RISE=1,    // value went up (e.g. off -> on or -5 -> 0)
+		IN_FALL=2,    // value went down (e.g. on -> off or 0 -> -5)
+		IN_HIGH=4,    // value unchanged and on (!= 0)
+		IN_LOW=8,     // value unchanged and off (== 0)
+		IN_CHANGE=IN_RISE|IN_FALL,
+		IN_STEADY=IN_HIGH|IN_LOW,
+		IN_ALL=IN_CHANGE|IN_STEADY
+	};
+
+	// Interest flag matching an activation
+	inline uint8_t interestOf( knob_value_t newState, knob_value_t oldState ) {
+
+		if( newState == oldState ) return newState ? IN_HIGH : IN_LOW;
+
+		return newState > oldState ? IN_RISE : IN_FALL;
+	}
+
 
 	 // A handler encapsulates on type of action which is looked for in order to do something.
 	 // Examples are: push, click, hold, etc...
@@ -58,12 +137,20 @@ namespace Knobs {
 	class Handler {
 
 		friend class Device;
+		friend class Panel;
 
 		protected:
 
 			const callback_t _cb;
 			const minimal_callback_t _cbm;
 
+			// see Interest. Set by subclasses. Default: IN_ALL
+			uint8_t _interest;
+
+#if KNOBS_PROFILE
+			TimeStats _stats;
+#endif
+
 			virtual bool _callback( Device &dev,
 					knob_value_t newState, knob_value_t oldState, knob_time_t count );
 
@@ -79,6 +166,23 @@ namespace Knobs {
 			virtual bool handle( Device &dev,
 					knob_value_t newState, knob_value_t oldState, knob_time_t count ) = 0;
 
+			// time until handle must be called again if state stays the same
+			// for 'time'. Override if the Handler acts without state changes.
+			virtual knob_time_t due( knob_value_t state, knob_time_t time );
+
+			// Interest flags. handle() must do nothing but return true
+			// for activations not covered here.
+			inline uint8_t interest() {
+				return _interest;
+			}
+
+#if KNOBS_PROFILE
+			// duration of callbacks
+			inline TimeStats &stats() {
+				return _stats;
+			}
+#endif
+
 	};
 
 	// Callback every loop
@@ -92,6 +196,8 @@ namespace Knobs {
 			virtual bool handle( Device &dev,
 					knob_value_t newState, knob_value_t oldState, knob_time_t time );
 
+			virtual knob_time_t due( knob_value_t state, knob_time_t time );
+
 	};
 
 	// Calls back when state changes off -> on
@@ -147,6 +253,8 @@ namespace Knobs {
 
 			virtual bool handle( Device &dev,
 					knob_value_t newState, knob_value_t oldState, knob_time_t time );
+
+			virtual knob_time_t due( knob_value_t state, knob_time_t time );
 	};
 
 	// Calls back when state changes off -> on -> off
@@ -179,7 +287,7 @@ namespace Knobs {
 		private:
 
 			static const knob_time_t MAX_TIME_CLICK = 0;
-			static const knob_time_t MAX_TIME_INBETWEEN = 750;
+			static const knob_time_t MAX_TIME_INBETWEEN = KNOB_MS( 750 );
 
 			const knob_time_t _maxTimeInbetween;
 			const uint8_t _maxClicks;
@@ -214,8 +322,8 @@ namespace Knobs {
 
 		private:
 
-			static const knob_time_t MAX_TIME_CLICK = 250;
-			static const knob_time_t MAX_TIME_INBETWEEN = 750;
+			static const knob_time_t MAX_TIME_CLICK = KNOB_MS( 250 );
+			static const knob_time_t MAX_TIME_INBETWEEN = KNOB_MS( 750 );
 
 			const knob_time_t _maxTimeInbetween;
 
@@ -258,6 +366,8 @@ namespace Knobs {
 			virtual bool handle( Device &dev,
 					knob_value_t newState, knob_value_t oldState, knob_time_t time );
 
+			virtual knob_time_t due( knob_value_t state, knob_time_t time );
+
 			Hold& continues( bool on );
 
 	};
@@ -322,19 +432,69 @@ namespace Knobs {
 	class Device {
 
 		friend class Panel;
+		friend class EventQueue;
+		friend class Handler;
 
 		private:
 			const char *_name;
+#if KNOBS_TRACE
+			uint8_t _traceId;
+#endif
+#if KNOBS_PROFILE
+			// whole loop (Panel) and running/queueing handlers
+			TimeStats _loopStats;
+			TimeStats _dispatchStats;
+#endif
 			Canister<Handler,KNOBS_HANDLER_CANISTER_SIZE> _handlers;
 
 			Device *_slave;
+			EventQueue *_queue;
+			// in _queue. See Event
+			uint8_t _queueIndex;
+
+			// combined interest of handlers
+			uint8_t _interest;
+
+			// only pass changes and steady states handlers are due for
+			bool _coalesce;
+			knob_time_t _woken;
+			knob_time_t _wait;
+
+			// own or slave's handlers want to see this
+			bool _interested( uint8_t what );
+
+			// run the handlers (and slave's)
+			void _dispatch( knob_value_t newState,
+					knob_value_t oldState, knob_time_t count, knob_time_t now );
 
 		protected:
+			knob_time_t _now;
+
+			// run own handlers. Returns false if the chain was stopped.
+			// Override to dispatch handlers stored elsewhere.
+			virtual bool _handle( knob_value_t newState,
+					knob_value_t oldState, knob_time_t count );
+			// min. due of own handlers
+			virtual knob_time_t _handlersDue( knob_value_t state, knob_time_t time );
+
+			// add interest of handlers stored elsewhere
+			void _interests( uint8_t what );
+
 			void _activate( knob_value_t newState,
 					knob_value_t oldState, knob_time_t count );
+			void _activate( knob_value_t newState,
+					knob_value_t oldState, knob_time_t count, knob_time_t now );
 			Device( const char *name );
+			// gives back the slots taken from the Shelf
+			~Device();
 			bool _mute;
 
+			// called by Panel when port sampling is switched on/off
+			virtual void _attach( PortSnapshot *snapshot ) {}
+
+			// min. due of all handlers (and slave's)
+			knob_time_t _due( knob_value_t state, knob_time_t time );
+
 		public:
 			// remote controll other Device
 			Device& enslave( Device &slave );
@@ -342,46 +502,87 @@ namespace Knobs {
 			// pause operation
 			Device& mute( bool mute );
 
+			// Run handlers only on changes and when one of them is due
+			// (see Handler::due) instead of on every loop. Handlers which
+			// act without changes must implement due() then.
+			// Has no effect while a queue is used.
+			Device& coalesce( bool on );
+
+			// only record activations in queue. Handlers are run
+			// when the queue is dispatched. Runs them directly if
+			// KNOBS_EVENT_QUEUE_DEVICES devices use queue already.
+			Device& queue( EventQueue &queue );
+			// run handlers directly again
+			Device& unqueue();
+
 			// must be called periodically. At best < every 20ms
 			virtual void loop() = 0;
+			// same with the time of this tick. Panel uses this so all devices
+			// and handlers see the same time. Default calls loop()
+			virtual void loop( knob_time_t now );
+
+			// time until loop must be called again if the input doesn't change.
+			// Default is 0 which means: poll continuously.
+			virtual knob_time_t due( knob_time_t now );
 
-			// add a handler
+			// add a handler. Takes a slot from the Shelf if the Device's
+			// storage is full. Nothing is added if it is exhausted. See
+			// handlerOverflow().
 			Device& on( Handler &handler );
+			// amount of handlers on() could not add. Also counted in
+			// canisterOverflows().
+			int handlerOverflow();
+
+			// keep handlers in storage for up to capacity handlers instead of
+			// the built in or shelved slots. Returns false if too small.
+			bool handlers( Handler **storage, int capacity );
 
 			// return name
 			const char *name();
 
+			// time at which the state currently handled occured
+			knob_time_t now();
+
+#if KNOBS_PROFILE
+			// duration of loop when called by a Panel (sampling and
+			// dispatching) and of dispatching an activation
+			TimeStats &loopStats();
+			TimeStats &dispatchStats();
+#endif
+
+			// add a handler from WHAT's pool. Nothing is added if it is exhausted.
+			template <typename T>
+			inline Device& on( T *handler ) {
+				if( handler ) on( *handler );
+				return *this;
+			}
+
+			#define _POOL( WHAT ) Pool<WHAT, KNOBS_POOL_ ## WHAT>
 			#define ON( WHAT ) \
 					inline Device& on ## WHAT( minimal_callback_t cb ) { \
-						on( *( new WHAT( cb ) ) ); \
-						return *this; \
+						return on( _POOL( WHAT )::make( cb ) ); \
 					} \
 					inline Device& on ## WHAT( callback_t cb ) { \
-						on( *( new WHAT( cb ) ) ); \
-						return *this; \
+						return on( _POOL( WHAT )::make( cb ) ); \
 					}
 			#define ONP( WHAT, TYPE ) \
 					inline Device& on ## WHAT( minimal_callback_t cb, TYPE val ) { \
-						on( *( new WHAT( cb, val ) ) ); \
-						return *this; \
+						return on( _POOL( WHAT )::make( cb, val ) ); \
 					} \
 					inline Device& on ## WHAT( callback_t cb, TYPE val ) { \
-						on( *( new WHAT( cb, val ) ) ); \
-						return *this; \
+						return on( _POOL( WHAT )::make( cb, val ) ); \
 					}
 			#define ONPP( WHAT, TYPE1, TYPE2 ) \
 					inline Device& on ## WHAT( minimal_callback_t cb, TYPE1 val1, TYPE2 val2 ) { \
-						on( *( new WHAT( cb, val1, val2 ) ) ); \
-						return *this; \
+						return on( _POOL( WHAT )::make( cb, val1, val2 ) ); \
 					} \
 					inline Device& on ## WHAT( callback_t cb, TYPE1 val1, TYPE2 val2 ) { \
-						on( *( new WHAT( cb, val1, val2 ) ) ); \
-						return *this; \
+						return on( _POOL( WHAT )::make( cb, val1, val2 ) ); \
 					}
 
 			// add handlers. see there for what they do.
-			// note that these methods must use 'new' to create the handlers
-			// so keep an eye on the heap
+			// Handlers are taken from static pools of KNOBS_POOL_<Type> entries.
+			// If one is exhausted the handler is missing and poolFailures() counts up.
 			ON( Always )
 			ON( Push )
 			ON( Release )
@@ -405,6 +606,12 @@ namespace Knobs {
 			bool _invert;
 			bool _read();
 
+			// if set read from Panel's snapshot instead of the pin
+			const uint8_t *_sample;
+			uint8_t _mask;
+
+			virtual void _attach( PortSnapshot *snapshot );
+
 		public:
 			BooleanDevice( const char *name, pin_t pin );
 
@@ -418,12 +625,50 @@ namespace Knobs {
 
 	};
 
+	// Edges of one pin as recorded by an interrupt.
+	// Written from the interrupt, read from the loop. Wait free like
+	// EventQueue.
+	class EdgeBuffer {
+
+		public:
+			struct Edge {
+				uint32_t time;
+				bool level;
+			};
+
+		private:
+			Edge _edges[ KNOBS_EDGE_BUFFER ];
+
+			uint8_t _head; // written by interrupt
+			uint8_t _tail; // written by loop
+			bool _overrun;
+
+		public:
+			EdgeBuffer();
+
+			// add edge. Called from interrupt
+			void push( uint32_t time, bool level );
+			// take oldest edge. returns false if empty
+			bool pop( Edge &edge );
+			// true if edges can be taken
+			bool waiting();
+			// true if edges were lost since last call
+			bool overrun();
+			// forget everything
+			void clear();
+	};
+
 	// Knob: An implementation of an boolean device which is debounced.
+	//
+	// Usually the pin is sampled every loop. In interrupt mode every
+	// edge is timestamped by a pin change interrupt and debouncing is
+	// done from these timestamps. So durations are exact and loop can
+	// be called less often.
 	class Knob : public BooleanDevice {
 
 		private:
 
-			static const knob_time_t TIME_DEBOUNCE = 25; //ms
+			static const knob_time_t TIME_DEBOUNCE = KNOB_MS( 25 );
 
 			knob_value_t _value;
 
@@ -433,6 +678,18 @@ namespace Knobs {
 			knob_time_t _timeDebounce;
 			knob_time_t _countDebounce;
 
+			// level read last. In interrupt mode: of the last edge
+			knob_value_t _raw;
+
+			// interrupt mode
+			int8_t _irq;
+			knob_time_t _rawTime;
+			knob_time_t _burst;
+			knob_time_t _since;
+
+			void _loopEdges( knob_time_t now );
+			void _edge( knob_value_t level, knob_time_t time );
+			void _commit();
 
 		public:
 
@@ -440,10 +697,42 @@ namespace Knobs {
 
 			Knob& debounce( knob_time_t time );
 
+			// use pin change interrupt. Stays in polling mode if all
+			// KNOBS_INTERRUPTS are in use. If the pin has no external interrupt
+			// call edge() from your own (e.g. pin change) ISR.
+			Knob& interrupt( bool on );
+			// true if operated by interrupt
+			bool interrupted();
+
+			// record edge. Called from interrupt
+			void edge();
+
 			knob_value_t value();
 
 			virtual void loop();
+			virtual void loop( knob_time_t now );
+
+			virtual knob_time_t due( knob_time_t now );
+
+	};
+
+	// Input registers of all ports used by a Panel.
+	// Every port is read once per loop so all devices see the same instant.
+	class PortSnapshot {
+
+		private:
+			uint16_t _used;
+			uint8_t _value[ KNOBS_PORTS ];
+
+		public:
+			PortSnapshot();
 
+			// register pin's port. Returns where its value is sampled to
+			// or NULL if port access isn't supported.
+			const uint8_t *use( pin_t pin );
+
+			// read all used ports
+			void sample();
 	};
 
 	// Small helper class to get your knobs organized.
@@ -453,6 +742,20 @@ namespace Knobs {
 
 			const char *_name;
 			Canister<Device, KNOBS_PANEL_CANISTER_SIZE> _devices;
+			NameIndex<Device, KNOBS_NAME_INDEX> _index;
+
+			PortSnapshot _snapshot;
+			bool _sampling;
+
+			EventQueue *_queue;
+
+#if KNOBS_PROFILE
+			TimeStats _stats;
+			uint32_t _deadline;
+			uint32_t _overruns;
+#endif
+
+			void _init();
 
 		public:
 
@@ -474,12 +777,50 @@ namespace Knobs {
 			// add another Device
 			Panel& operator <<( Device &device );
 
+			// keep devices in storage for up to capacity devices instead of
+			// the built in KNOBS_PANEL_CANISTER_SIZE. Returns false if too small.
+			bool devices( Device **storage, int capacity );
+
+			// read whole ports once per loop instead of one digitalRead per Knob
+			Panel& snapshot( bool on );
+
+			// Find the first Device whose name is a prefix of query.
+			// Uses an index if KNOBS_NAME_INDEX is set.
+			Device* find( const char *query );
+
+			// let all devices use queue. See Device::queue
+			Panel& queue( EventQueue &queue );
+
 			// call periodicalle. At best faster than 20ms
 			void loop();
+			// same with the time of this tick
+			void loop( knob_time_t now );
+
+			// time until loop must be called again. Until then only an
+			// input change needs attention. So you can sleep that long
+			// or until a pin changes.
+			knob_time_t due();
 
 			// return name
 			const char * name();
 
+#if KNOBS_PROFILE
+			// duration of whole loops
+			TimeStats &stats();
+
+			// count loops longer than us. 0: none
+			Panel& deadline( uint32_t us );
+			uint32_t overruns();
+
+			// Device with the longest loop
+			Device *slowest();
+
+			// reset statistics of panel, devices and their handlers
+			Panel& resetStats();
+
+			// debug print statistics of panel, devices and handlers
+			Panel& printStats();
+#endif
 	};
 }
 
@@ -0,0 +1,199 @@
+#include "KnobBank.h"
+
+#include <Arduino.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+using namespace Knobs;
+
+/*****************************************************************************
+*
+*   K E Y
+*
+*****************************************************************************/
+
+Key::Key( const char *name, pin_t pin )
+		: BooleanDevice( name, pin ) {
+
+	_value = 0;
+	_timeUnchanged = 0;
+
+	pinMode( pin, INPUT );
+}
+
+Key::Key( const char *name )
+		: BooleanDevice( name, KNOBS_NO_PIN ) {
+
+	_value = 0;
+	_timeUnchanged = 0;
+}
+
+knob_value_t Key::value() {
+
+	return _value;
+}
+
+void Key::_update( knob_value_t value, knob_time_t delta, knob_time_t now ) {
+
+	if( _mute ) return;
+
+	knob_value_t oldValue = _value;
+
+	if( value != _value )
+			_timeUnchanged = 0;
+
+	_timeUnchanged += delta;
+
+	_value = value;
+
+	_activate( value, oldValue, _timeUnchanged, now );
+}
+
+
+/*****************************************************************************
+*
+*   K N O B  B A N K
+*
+*****************************************************************************/
+
+KnobBank::KnobBank( const char *name ) : Device( name ) {
+
+	_state = 0;
+	_ct0 = ~(bank_mask_t)0;
+	_ct1 = ~(bank_mask_t)0;
+
+	_lastTime = 0;
+	_lastSample = 0;
+	_timeUnchanged = 0;
+	_timeSample = TIME_DEBOUNCE / 4;
+}
+
+KnobBank& KnobBank::operator <<( Key &key ) {
+
+	_keys.add( key );
+
+	return *this;
+}
+
+KnobBank& KnobBank::debounce( knob_time_t time ) {
+
+	_timeSample = time / 4;
+
+	return *this;
+}
+
+knob_value_t KnobBank::_down( bank_mask_t mask ) {
+
+#if KNOBS_BANK_WIDTH == 64
+	return __builtin_popcountll( mask );
+#else
+	return __builtin_popcountl( mask );
+#endif
+}
+
+bank_mask_t KnobBank::state() {
+
+	return _state;
+}
+
+bank_mask_t KnobBank::_sample() {
+
+	bank_mask_t raw = 0,
+	            bit = 1;
+	Key *key;
+
+	for( Cursor<Key> it( _keys ); ( key = it.next() ); ) {
+
+		if( key->_read() ) raw |= bit;
+		bit <<= 1;
+	}
+
+	return raw;
+}
+
+void KnobBank::_attach( PortSnapshot *snapshot ) {
+
+	Key *key;
+
+	for( Cursor<Key> it( _keys ); ( key = it.next() ); ) {
+
+		key->_attach( snapshot );
+	}
+}
+
+void KnobBank::loop() {
+
+	loop( uptime() );
+}
+
+void KnobBank::loop( knob_time_t now ) {
+
+	if( _mute ) return;
+
+	knob_time_t delta = now - _lastTime;
+
+	bank_mask_t oldState = _state;
+
+	_lastTime = now;
+
+	if( now - _lastSample >= _timeSample ) {
+
+		_lastSample = now;
+
+		// count every changed key down, reset the unchanged ones.
+		// Keys whose counter rolls over toggle.
+		bank_mask_t changed = _state ^ _sample();
+
+		_ct0 = ~( _ct0 & changed );
+		_ct1 = _ct0 ^ ( _ct1 & changed );
+
+		_state ^= changed & _ct0 & _ct1;
+	}
+
+	bank_mask_t bit = 1;
+	Key *key;
+
+	for( Cursor<Key> it( _keys ); ( key = it.next() ); ) {
+
+		key->_update( ( _state & bit ) ? 1 : 0, delta, now );
+		bit <<= 1;
+	}
+
+	if( _state != oldState )
+			_timeUnchanged = 0;
+
+	_timeUnchanged += delta;
+
+	_activate( _down( _state ), _down( oldState ), _timeUnchanged, now );
+}
+
+knob_time_t KnobBank::due( knob_time_t now ) {
+
+	if( _mute ) return KNOB_TIME_NEVER;
+
+	// some counter is running
+	if( ~( _ct0 & _ct1 ) ) {
+
+		knob_time_t wait = _timeSample - ( now - _lastSample );
+
+		return wait > 0 ? wait : 0;
+	}
+
+	knob_time_t elapsed = now - _lastTime,
+	            due, min = _due( _down( _state ), _timeUnchanged + elapsed );
+	Key *key;
+
+	for( Cursor<Key> it( _keys ); ( key = it.next() ); ) {
+
+		if( key->_mute ) continue;
+
+		due = key->_due( key->_value, key->_timeUnchanged + elapsed );
+		if( due < min ) min = due;
+	}
+
+	return min > 0 ? min : 0;
+}
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,110 @@
+#ifndef KNOBBANK_H
+#define KNOBBANK_H
+
+#include "Knob.h"
+
+#include <stdint.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+// Amount of Keys per bank. 32 or 64
+#ifndef KNOBS_BANK_WIDTH
+	#define KNOBS_BANK_WIDTH 32
+#endif
+
+namespace Knobs {
+
+#if KNOBS_BANK_WIDTH == 64
+	typedef uint64_t bank_mask_t;
+#elif KNOBS_BANK_WIDTH == 32
+	typedef uint32_t bank_mask_t;
+#else
+	#error "KNOBS_BANK_WIDTH must be 32 or 64"
+#endif
+
+	class KnobBank;
+
+	// Key: One input of a KnobBank.
+	// Handlers see the same as on a Knob but debouncing is done by the bank.
+	class Key : public BooleanDevice {
+
+		friend class KnobBank;
+
+		private:
+			knob_value_t _value;
+			knob_time_t _timeUnchanged;
+
+			void _update( knob_value_t value, knob_time_t delta, knob_time_t now );
+
+		public:
+			Key( const char *name, pin_t pin );
+			// Key without a pin of its own. (e.g. in a Keypad)
+			Key( const char *name );
+
+			knob_value_t value();
+
+			// Keys are sampled by their bank
+			virtual void loop() {}
+	};
+
+	// KnobBank: Debounces up to KNOBS_BANK_WIDTH Keys at once.
+	//
+	// Uses a vertical counter: Every bit of the two counter words is one
+	// 2 bit counter per Key. A Key changes state after it was sampled
+	// 4 times in a row in the new state. Samples are taken every
+	// debounce/4 ms so the debounce time matches the one of Knob.
+	//
+	// The bank's own handlers get the amount of Keys down as value. So
+	// Push is the first Key going down, Release the last one going up
+	// and Over( 2 ) two at once. state() tells which ones.
+	class KnobBank : public Device {
+
+		private:
+
+			static const knob_time_t TIME_DEBOUNCE = KNOB_MS( 25 );
+
+			Canister<Key, KNOBS_BANK_WIDTH> _keys;
+
+			bank_mask_t _state;
+			bank_mask_t _ct0, _ct1;
+
+			knob_time_t _lastTime;
+			knob_time_t _lastSample;
+			// since _state changed. For the bank's own handlers
+			knob_time_t _timeUnchanged;
+			knob_time_t _timeSample;
+
+			// keys down in mask
+			static knob_value_t _down( bank_mask_t mask );
+
+		protected:
+
+			// return raw state of all keys. Bit n is the n-th Key.
+			virtual bank_mask_t _sample();
+
+			virtual void _attach( PortSnapshot *snapshot );
+
+		public:
+
+			KnobBank( const char *name );
+
+			// add another Key
+			KnobBank& operator <<( Key &key );
+
+			KnobBank& debounce( knob_time_t time );
+
+			// debounced state of all keys
+			bank_mask_t state();
+
+			virtual void loop();
+			virtual void loop( knob_time_t now );
+
+			virtual knob_time_t due( knob_time_t now );
+	};
+}
+
+#pragma GCC diagnostic pop
+
+#endif
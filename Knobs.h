@@ -2,7 +2,14 @@
 #define KNOBS_H
 
 #include "Knob.h"
+#include "KnobBank.h"
+#include "Encoder.h"
+#include "Keypad.h"
+#include "ShiftRegister.h"
+#include "EventQueue.h"
+#include "StaticKnob.h"
 #include "Valve.h"
 #include "Lever.h"
+#include "Remote.h"
 
 #endif
@@ -50,6 +50,7 @@ Lever::Lever( const char *name, pin_t pin, knob_value_t min, knob_value_t max )
 
 	_old = 0;
 	_lastTime = 0;
+	_sampleTime = 0;
 }
 
 Lever& Lever::modify( LeverModifier &modifier ) {
@@ -58,12 +59,17 @@ Lever& Lever::modify( LeverModifier &modifier ) {
 	return *this;
 }
 
+bool Lever::modifiers( LeverModifier **storage, int capacity ) {
+
+	return _modifiers.reserve( storage, capacity );
+}
+
 bool Lever::modify( knob_value_t *val_p ) {
 
 	register bool ok = true;
 	register LeverModifier *mod;
 
-	for( mod = _modifiers.first(); mod && ok; mod = _modifiers.next() ) {
+	for( Cursor<LeverModifier> it( _modifiers ); ( mod = it.next() ) && ok; ) {
 
 		ok = mod->modify( *this, val_p );
 	}
@@ -73,21 +79,34 @@ bool Lever::modify( knob_value_t *val_p ) {
 
 void Lever::activate( knob_value_t val ) {
 
-	knob_time_t now;
+	activate( val, uptime() );
+}
+
+void Lever::activate( knob_value_t val, knob_time_t now ) {
 
-	now = millis();
-	_activate( val, _old, now - _lastTime );
+	_activate( val, _old, now - _lastTime, now );
 	_old = val;
 	_lastTime = now;
 }
 
+knob_time_t Lever::sampleTime() {
+	return _sampleTime;
+}
+
 void Lever::loop(){
 
+	loop( uptime() );
+}
+
+void Lever::loop( knob_time_t now ){
+
+	_sampleTime = now;
+
 	knob_value_t val = _read();
 
 	if( modify( &val ) ) {
 
-		activate( val );
+		activate( val, now );
 	}
 }
 
@@ -151,7 +170,7 @@ AverageTime::AverageTime( knob_time_t time )
 
 bool AverageTime::modify( Lever &lever, knob_value_t *val ) {
 
-	knob_time_t now = millis(),
+	knob_time_t now = lever.sampleTime(),
 	       span = now - _start;
 
 	_sum += *val;
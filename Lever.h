@@ -56,8 +56,14 @@ namespace Knobs {
 			knob_time_t _lastTime;
 
 		protected:
+			// time of the tick being sampled. Not now(): That belongs
+			// to the activation the handlers are running for, which
+			// may be an older one from a queue.
+			knob_time_t _sampleTime;
+
 			virtual bool modify( knob_value_t *val );
 			virtual void activate( knob_value_t val );
+			virtual void activate( knob_value_t val, knob_time_t now );
 
 		public:
 			const knob_value_t minValue;
@@ -68,7 +74,14 @@ namespace Knobs {
 
 			Lever& modify( LeverModifier &modifier );
 
+			// keep modifiers in storage for up to capacity modifiers. Returns false if too small.
+			bool modifiers( LeverModifier **storage, int capacity );
+
 			virtual void loop();
+			virtual void loop( knob_time_t now );
+
+			// time of the tick the modifiers work on
+			knob_time_t sampleTime();
 	};
 
 	/*****************
@@ -0,0 +1,167 @@
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <stdint.h>
+#include <string.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+#include "Canister.h"
+
+// Slots of the name index of Panels and Transducers. Power of 2. With
+// more than half as many names or 0 names are searched.
+#ifndef KNOBS_NAME_INDEX
+	#define KNOBS_NAME_INDEX 0
+#endif
+
+namespace Knobs {
+
+	// first of items whose name is a prefix of query. Walks all items.
+	template <typename T>
+	T *findName( CanisterBase<T> &items, const char *query ) {
+
+		T *item;
+
+		for( Cursor<T> it( items ); ( item = it.next() ); ) {
+
+			const char *name = item->name();
+
+			if( strncmp( name, query, strlen( name ) ) == 0 ) return item;
+		}
+
+		return NULL;
+	}
+
+	// Lookup of items by name()
+	//
+	// find( query ) returns the first added item whose name is a prefix
+	// of query. (So "valve1 on" finds "valve1")
+	//
+	// The index is a hash table of the names which is built on first use
+	// after items were added. A query is hashed char by char and looked
+	// up only for lengths some name has. So the cost depends on the length
+	// of the query but not on the amount of items.
+	// Only pointers to the names are kept. Names are read with strncmp()
+	// so they must be in RAM (no F() strings).
+	template <typename T, int N>
+	class NameIndex {
+
+		private:
+
+			struct Slot {
+				uint32_t hash;
+				uint8_t length;
+				uint8_t order;
+				T *item;
+			};
+
+			Slot _slots[ N ];
+
+			// bit n: some name has length n. bit 31: some is longer
+			uint32_t _lengths;
+			bool _built;
+			// more items than fit: search them
+			bool _full;
+
+			static inline uint32_t _hash( uint32_t hash, char c ) {
+				return ( hash ^ (uint8_t)c ) * 16777619u;
+			}
+
+			void _build( CanisterBase<T> &items ) {
+
+				T *item;
+				uint8_t order = 0;
+
+				memset( _slots, 0, sizeof( _slots ) );
+				_lengths = 0;
+				_full = items.fill() > N/2 || items.fill() > 0xff;
+				_built = true;
+
+				if( _full ) return;
+
+				for( Cursor<T> it( items ); ( item = it.next() ); order++ ) {
+
+					const char *name = item->name();
+					uint32_t hash = 2166136261u;
+					uint8_t length = 0;
+
+					for( ; name[ length ] && length < 0xff; length++ ) hash = _hash( hash, name[ length ] );
+
+					_lengths |= 1ul << ( length < 31 ? length : 31 );
+
+					// linear probing
+					for( int i = 0; i < N; i++ ) {
+
+						Slot &slot = _slots[ ( hash + i ) & ( N-1 ) ];
+
+						if( slot.item ) continue;
+
+						slot.hash = hash;
+						slot.length = length;
+						slot.order = order;
+						slot.item = item;
+						break;
+					}
+				}
+			}
+
+		public:
+
+			NameIndex() : _lengths( 0 ), _built( false ), _full( false ) {}
+
+			// items changed. Rebuild on next find.
+			inline void invalidate() {
+				_built = false;
+			}
+
+			T *find( CanisterBase<T> &items, const char *query ) {
+
+				if( !_built ) _build( items );
+				if( _full ) return findName( items, query );
+
+				uint32_t hash = 2166136261u;
+				Slot *best = NULL;
+
+				for( uint8_t length = 1; query[ length-1 ] && length < 0xff; length++ ) {
+
+					hash = _hash( hash, query[ length-1 ] );
+
+					if( !( _lengths & ( 1ul << ( length < 31 ? length : 31 ) ) ) ) continue;
+
+					for( int i = 0; i < N; i++ ) {
+
+						Slot &slot = _slots[ ( hash + i ) & ( N-1 ) ];
+
+						if( !slot.item ) break;
+
+						if( slot.hash != hash || slot.length != length ) continue;
+						if( best && best->order < slot.order ) continue;
+						if( strncmp( slot.item->name(), query, length ) ) continue;
+
+						best = &slot;
+					}
+				}
+
+				return best ? best->item : NULL;
+			}
+	};
+
+	// Without index: Search all items.
+	template <typename T>
+	class NameIndex<T, 0> {
+
+		public:
+
+			inline void invalidate() {}
+
+			inline T *find( CanisterBase<T> &items, const char *query ) {
+				return findName( items, query );
+			}
+	};
+}
+
+#pragma GCC diagnostic pop
+
+#endif
@@ -0,0 +1,218 @@
+#include "Outlet.h"
+
+#include <Arduino.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+using namespace Knobs;
+
+// the host build puts what was written to the registers to its pins
+#ifndef portWritten
+	#define portWritten( P )
+#endif
+
+/*****************************************************************************
+*
+*   O U T L E T
+*
+*****************************************************************************/
+
+Outlet::Outlet() : _held( 0 ), _dirty( false ) {}
+
+void Outlet::_changed() {
+
+	if( _held ) {
+		_dirty = true;
+		return;
+	}
+
+	_flush();
+}
+
+void Outlet::hold() {
+
+	_held++;
+}
+
+void Outlet::release() {
+
+	if( !_held || --_held ) return;
+
+	if( _dirty ) {
+		_dirty = false;
+		_flush();
+	}
+}
+
+
+/*****************************************************************************
+*
+*   P O R T  O U T L E T
+*
+*****************************************************************************/
+
+PortOutlet::PortOutlet() : _used( 0 ) {
+
+	memset( _set, 0, sizeof( _set ) );
+	memset( _clr, 0, sizeof( _clr ) );
+	memset( _out, 0, sizeof( _out ) );
+	memset( _in, 0, sizeof( _in ) );
+}
+
+bool PortOutlet::supports( pin_t pin ) {
+
+#ifdef portOutputRegister
+	uint8_t port = digitalPinToPort( pin );
+
+	return port != NOT_A_PORT && port < KNOBS_PORTS;
+#else
+	return false;
+#endif
+}
+
+outlet_addr_t PortOutlet::address( pin_t pin ) {
+
+#ifdef portOutputRegister
+	return (outlet_addr_t)digitalPinToPort( pin ) << 8 | digitalPinToBitMask( pin );
+#else
+	return 0;
+#endif
+}
+
+void PortOutlet::mode( outlet_addr_t addr, bool output ) {
+
+#ifdef portOutputRegister
+	uint8_t port = addr >> 8,
+	        bit = addr & 0xff;
+
+	if( output ) {
+		_out[ port ] |= bit;
+		_in[ port ] &= ~bit;
+	} else {
+		_in[ port ] |= bit;
+		_out[ port ] &= ~bit;
+	}
+
+	_used |= 1 << port;
+
+	_changed();
+#endif
+}
+
+void PortOutlet::write( outlet_addr_t addr, bool level ) {
+
+#ifdef portOutputRegister
+	uint8_t port = addr >> 8,
+	        bit = addr & 0xff;
+
+	if( level ) {
+		_set[ port ] |= bit;
+		_clr[ port ] &= ~bit;
+	} else {
+		_clr[ port ] |= bit;
+		_set[ port ] &= ~bit;
+	}
+
+	_used |= 1 << port;
+
+	_changed();
+#endif
+}
+
+void PortOutlet::_flush() {
+
+#ifdef portOutputRegister
+	uint16_t used = _used;
+
+	for( uint8_t port = 0; used; port++, used >>= 1 ) {
+
+		if( !( used & 1 ) ) continue;
+
+		volatile uint8_t *out = portOutputRegister( port ),
+		                 *ddr = portModeRegister( port );
+		knobs_irq_t irq;
+
+		// ISRs may write other pins of the port
+		KNOBS_LOCK( irq );
+		*out = ( *out & ~_clr[ port ] ) | _set[ port ];
+		if( _out[ port ] | _in[ port ] ) *ddr = ( *ddr & ~_in[ port ] ) | _out[ port ];
+		KNOBS_UNLOCK( irq );
+
+		portWritten( port );
+
+		_set[ port ] = 0;
+		_clr[ port ] = 0;
+		_out[ port ] = 0;
+		_in[ port ] = 0;
+	}
+
+	_used = 0;
+#endif
+}
+
+
+/*****************************************************************************
+*
+*   S H I F T  O U T L E T
+*
+*****************************************************************************/
+
+ShiftOutlet::ShiftOutlet( pin_t latch, pin_t clock, pin_t data, uint8_t chips )
+		: _latch( latch ), _clock( clock ), _data( data )
+		, _chips( chips > KNOBS_SHIFTOUT_CHIPS ? KNOBS_SHIFTOUT_CHIPS : chips )
+		{
+
+	memset( _bits, 0, sizeof( _bits ) );
+
+	pinMode( latch, OUTPUT );
+	pinMode( clock, OUTPUT );
+	pinMode( data, OUTPUT );
+
+	digitalWrite( latch, LOW );
+	digitalWrite( clock, LOW );
+}
+
+void ShiftOutlet::write( outlet_addr_t addr, bool level ) {
+
+	uint8_t chip = addr >> 3,
+	        bit = 1 << ( addr & 7 );
+
+	if( chip >= _chips ) return;
+
+	if( level ) _bits[ chip ] |= bit;
+	else _bits[ chip ] &= ~bit;
+
+	_changed();
+}
+
+bool ShiftOutlet::read( pin_t pin ) {
+
+	uint8_t chip = pin >> 3;
+
+	if( chip >= _chips ) return false;
+
+	return _bits[ chip ] & ( 1 << ( pin & 7 ) );
+}
+
+void ShiftOutlet::_flush() {
+
+	// the first bit shifted in ends up in Q7 of the last chip
+	for( int8_t chip = _chips-1; chip >= 0; chip-- ) {
+
+		uint8_t bits = _bits[ chip ];
+
+		for( uint8_t i = 0; i < 8; i++, bits <<= 1 ) {
+
+			digitalWrite( _data, ( bits & 0x80 ) ? HIGH : LOW );
+			digitalWrite( _clock, HIGH );
+			digitalWrite( _clock, LOW );
+		}
+	}
+
+	digitalWrite( _latch, HIGH );
+	digitalWrite( _latch, LOW );
+}
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,119 @@
+#ifndef OUTLET_H
+#define OUTLET_H
+
+#include <stdint.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+#include "knobs_common.h"
+
+// Max. amount of chained 74HC595
+#ifndef KNOBS_SHIFTOUT_CHIPS
+	#define KNOBS_SHIFTOUT_CHIPS 4
+#endif
+
+namespace Knobs {
+
+	// where a pin is in an Outlet. (see Outlet::address)
+	typedef uint16_t outlet_addr_t;
+
+	// An Outlet is where Valves put their state if they aren't
+	// connected to a pin of the MCU. (see Valve::outlet)
+	//
+	// Writes can be held back with hold() and are put out at once
+	// with the last release(). Transducer does so for all operations
+	// on its Valves.
+	class Outlet {
+
+		private:
+			uint8_t _held;
+			bool _dirty;
+
+		protected:
+			// put out everything written
+			virtual void _flush() = 0;
+
+			// call after every write
+			void _changed();
+
+		public:
+			Outlet();
+
+			// the Outlet's address of pin for mode() and write().
+			// Valves look it up once in begin().
+			virtual outlet_addr_t address( pin_t pin ) { return pin; }
+
+			// set pin to output or input (high impedance) if supported
+			virtual void mode( outlet_addr_t addr, bool output ) {}
+
+			virtual void write( outlet_addr_t addr, bool level ) = 0;
+
+			// hold back writes until as many release() as hold()
+			void hold();
+			void release();
+	};
+
+	// PortOutlet: Pins of the MCU. Writes are collected per port and put
+	// out with one read-modify-write of each port's output register.
+	// So all pins of a port switch at once. Modes follow in the mode
+	// register, so a pin becoming an output already has its level.
+	// Without port access (no portOutputRegister) nothing is supported.
+	class PortOutlet : public Outlet {
+
+		private:
+			uint16_t _used;
+			uint8_t _set[ KNOBS_PORTS ];
+			uint8_t _clr[ KNOBS_PORTS ];
+			uint8_t _out[ KNOBS_PORTS ];
+			uint8_t _in[ KNOBS_PORTS ];
+
+		protected:
+			virtual void _flush();
+
+		public:
+			PortOutlet();
+
+			// true if pin can be written by port
+			static bool supports( pin_t pin );
+
+			// port << 8 | bit mask
+			virtual outlet_addr_t address( pin_t pin );
+
+			virtual void mode( outlet_addr_t addr, bool output );
+			virtual void write( outlet_addr_t addr, bool level );
+	};
+
+	// ShiftOutlet: Chain of serial in/parallel out shift registers (74HC595).
+	//
+	// Pin n is output Qn%8 of the n/8-th chip counted from the MCU.
+	// Every flush shifts out the whole chain and pulses the latch once,
+	// so all outputs switch at the same time.
+	class ShiftOutlet : public Outlet {
+
+		private:
+			const pin_t _latch;
+			const pin_t _clock;
+			const pin_t _data;
+			const uint8_t _chips;
+
+			uint8_t _bits[ KNOBS_SHIFTOUT_CHIPS ];
+
+		protected:
+			virtual void _flush();
+
+		public:
+			// latch: ST_CP, clock: SH_CP, data: DS
+			ShiftOutlet( pin_t latch, pin_t clock, pin_t data, uint8_t chips );
+
+			virtual void write( outlet_addr_t addr, bool level );
+
+			// last written level of pin
+			bool read( pin_t pin );
+	};
+}
+
+#pragma GCC diagnostic pop
+
+#endif
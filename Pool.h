@@ -0,0 +1,75 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Fixed size pools with static storage.
+ *
+ * Used for the handlers created by Device's onXXX methods so setup
+ * needs no heap and RAM usage is known at link time. Only pools
+ * which are actually used take memory.
+ */
+
+// Default amount of handlers per type which can be created by onXXX
+#ifndef KNOBS_POOL_SIZE
+	#define KNOBS_POOL_SIZE 8
+#endif
+
+namespace Knobs {
+
+	// tag for our placement new. Not all Arduino cores have <new>.
+	struct PoolTag {};
+}
+
+inline void *operator new( size_t size, Knobs::PoolTag, void *where ) {
+	return where;
+}
+
+namespace Knobs {
+
+	// Amount of objects which couldn't be created because a pool was exhausted.
+	inline uint16_t &poolFailures() {
+		static uint16_t failures = 0;
+		return failures;
+	}
+
+	// Pool: Up to N objects of type T. Objects can't be freed.
+	template <typename T, int N>
+	class Pool {
+
+		private:
+			alignas( T ) static uint8_t _storage[ N > 0 ? N : 1 ][ sizeof( T ) ];
+			static uint8_t _used;
+
+		public:
+			// create new object. Returns NULL if the pool is exhausted.
+			template <typename... As>
+			static T *make( As... args ) {
+
+				if( _used >= N ) {
+					poolFailures()++;
+					return NULL;
+				}
+
+				return new( PoolTag(), _storage[ _used++ ] ) T( args... );
+			}
+
+			static int used() {
+				return _used;
+			}
+
+			static int capacity() {
+				return N;
+			}
+	};
+
+	template <typename T, int N>
+	alignas( T ) uint8_t Pool<T, N>::_storage[ N > 0 ? N : 1 ][ sizeof( T ) ];
+
+	template <typename T, int N>
+	uint8_t Pool<T, N>::_used = 0;
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include "Profile.h"
+
+#include <Arduino.h>
+
+#include <string.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+using namespace Knobs;
+
+/*****************************************************************************
+*
+*   T I M E  S T A T S
+*
+*****************************************************************************/
+
+TimeStats::TimeStats() {
+
+	reset();
+}
+
+void TimeStats::reset() {
+
+	count = 0;
+	min = 0;
+	max = 0;
+	sum = 0;
+
+	memset( buckets, 0, sizeof( buckets ) );
+}
+
+void TimeStats::add( uint32_t us ) {
+
+	uint8_t bucket = 0;
+
+	if( !count || us < min ) min = us;
+	if( us > max ) max = us;
+
+	sum += us;
+	count++;
+
+	for( uint32_t d = us; d > 1 && bucket < KNOBS_PROFILE_BUCKETS-1; d >>= 1 ) bucket++;
+
+	if( buckets[ bucket ] < 0xffff ) buckets[ bucket ]++;
+}
+
+uint32_t TimeStats::mean() {
+
+	return count ? sum / count : 0;
+}
+
+void TimeStats::print() {
+
+	uint8_t last = KNOBS_PROFILE_BUCKETS;
+
+	Serial.print( min );
+	Serial.print( "/" );
+	Serial.print( mean() );
+	Serial.print( "/" );
+	Serial.print( max );
+	Serial.print( "us n=" );
+	Serial.print( count );
+
+	// up to the last bucket used
+	while( last && !buckets[ last-1 ] ) last--;
+
+	Serial.print( " [" );
+	for( uint8_t i = 0; i < last; i++ ) {
+		if( i ) Serial.print( " " );
+		Serial.print( buckets[ i ] );
+	}
+	Serial.print( "]" );
+}
+
+#pragma GCC diagnostic pop
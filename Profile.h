@@ -0,0 +1,56 @@
+#ifndef KNOBS_PROFILE_H
+#define KNOBS_PROFILE_H
+
+#include <stdint.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+// Measure loop time of Panels and their Devices and callback time of
+// Handlers. 0: Nothing is compiled in.
+#ifndef KNOBS_PROFILE
+	#define KNOBS_PROFILE 0
+#endif
+// Histogram buckets. Bucket n counts durations of 2^n..2^(n+1)-1 us,
+// the last one all longer.
+#ifndef KNOBS_PROFILE_BUCKETS
+	#define KNOBS_PROFILE_BUCKETS 16
+#endif
+
+// Time the code between START and ADD. Needs micros() (Arduino.h)
+#if KNOBS_PROFILE
+	#define PROFILE_START( start ) uint32_t start = micros()
+	#define PROFILE_ADD( stats, start ) ( stats ).add( micros() - ( start ) )
+#else
+	#define PROFILE_START( start )
+	#define PROFILE_ADD( stats, start )
+#endif
+
+namespace Knobs {
+
+	// Statistics of durations in us
+	struct TimeStats {
+
+		uint32_t count;
+		uint32_t min;
+		uint32_t max;
+		uint64_t sum;
+		// saturate at 0xffff
+		uint16_t buckets[ KNOBS_PROFILE_BUCKETS ];
+
+		TimeStats();
+
+		void add( uint32_t us );
+		void reset();
+
+		uint32_t mean();
+
+		// debug print "min/mean/max" and the histogram
+		void print();
+	};
+}
+
+#pragma GCC diagnostic pop
+
+#endif
@@ -0,0 +1,292 @@
+#include "Remote.h"
+
+#include <string.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+using namespace Knobs;
+
+#if KNOBS_REMOTE_BUFFER & ( KNOBS_REMOTE_BUFFER - 1 ) || KNOBS_REMOTE_BUFFER > 128
+	#error "KNOBS_REMOTE_BUFFER must be a power of 2 not bigger than 128"
+#endif
+#if REMOTE_FRAME >= KNOBS_REMOTE_BUFFER
+	#error "KNOBS_REMOTE_BUFFER must hold a frame of KNOBS_REMOTE_PAYLOAD bytes"
+#endif
+
+#define _MASK ( KNOBS_REMOTE_BUFFER - 1 )
+
+// see EventQueue
+#define _LOAD( v ) __atomic_load_n( &(v), __ATOMIC_ACQUIRE )
+#define _STORE( v, n ) __atomic_store_n( &(v), (n), __ATOMIC_RELEASE )
+
+/*****************************************************************************
+*
+*   R E M O T E
+*
+*****************************************************************************/
+
+Remote::Remote() : _head( 0 ), _tail( 0 ), _send( NULL ), _ctx( NULL ), _errors( 0 ) {}
+
+Remote& Remote::operator <<( Transducer &transducer ) {
+
+	_transducers.add( transducer );
+	return *this;
+}
+
+Remote& Remote::operator <<( Valve &valve ) {
+
+	_valves.add( valve );
+	return *this;
+}
+
+Remote& Remote::output( remote_send_t send, void *ctx ) {
+
+	_send = send;
+	_ctx = ctx;
+
+	return *this;
+}
+
+bool Remote::feed( uint8_t byte ) {
+
+	uint8_t head = _head,
+	        next = ( head + 1 ) & _MASK;
+
+	if( next == _LOAD( _tail ) ) return false;
+
+	_buffer[ head ] = byte;
+
+	_STORE( _head, next );
+
+	return true;
+}
+
+int Remote::feed( const uint8_t *data, int length ) {
+
+	int count = 0, n;
+	uint8_t *to;
+
+	while( count < length && ( to = room( n ) ) ) {
+
+		if( n > length - count ) n = length - count;
+
+		memcpy( to, data + count, n );
+		commit( n );
+
+		count += n;
+	}
+
+	return count;
+}
+
+uint8_t *Remote::room( int &length ) {
+
+	uint8_t head = _head,
+	        free = ( _LOAD( _tail ) - head - 1 ) & _MASK;
+
+	// up to the end of the buffer
+	length = KNOBS_REMOTE_BUFFER - head;
+	if( length > free ) length = free;
+
+	return length ? &_buffer[ head ] : NULL;
+}
+
+void Remote::commit( int length ) {
+
+	_STORE( _head, ( _head + length ) & _MASK );
+}
+
+int Remote::fill() {
+
+	return ( _LOAD( _head ) - _LOAD( _tail ) ) & _MASK;
+}
+
+uint16_t Remote::errors() {
+
+	return _errors;
+}
+
+inline uint8_t Remote::_peek( uint8_t i ) {
+
+	return _buffer[ ( _tail + i ) & _MASK ];
+}
+
+uint32_t Remote::_peek32( uint8_t i ) {
+
+	return (uint32_t)_peek( i )
+			| (uint32_t)_peek( i+1 ) << 8
+			| (uint32_t)_peek( i+2 ) << 16
+			| (uint32_t)_peek( i+3 ) << 24;
+}
+
+int Remote::poll() {
+
+	uint8_t fill, length, check = 0, i;
+	int count = 0;
+
+	for( ;; ) {
+
+		fill = ( _LOAD( _head ) - _tail ) & _MASK;
+
+		// garbage or what's left of a bad frame
+		while( fill && _peek( 0 ) != REMOTE_SYNC ) {
+			_STORE( _tail, ( _tail + 1 ) & _MASK );
+			fill--;
+		}
+
+		if( fill < REMOTE_OVERHEAD ) break;
+
+		length = _peek( 3 );
+
+		if( length <= KNOBS_REMOTE_PAYLOAD ) {
+
+			if( fill < REMOTE_OVERHEAD + length ) break;
+
+			check = 0;
+			for( i = 1; i < REMOTE_OVERHEAD + length; i++ ) check += _peek( i );
+		}
+
+		// skip sync and look for the next one
+		if( length > KNOBS_REMOTE_PAYLOAD || check ) {
+
+			_errors++;
+			_STORE( _tail, ( _tail + 1 ) & _MASK );
+			continue;
+		}
+
+		_execute( _peek( 1 ), _peek( 2 ), length );
+
+		_STORE( _tail, ( _tail + REMOTE_OVERHEAD + length ) & _MASK );
+
+		count++;
+	}
+
+	return count;
+}
+
+void Remote::_execute( uint8_t op, uint8_t handle, uint8_t length ) {
+
+	Transducer *transducer = NULL;
+	Valve *valve = NULL;
+	uint8_t want = 0;
+
+	switch( op ) {
+
+		case REMOTE_PING:
+			break;
+
+		case REMOTE_MASK_SET:
+			want = 4;
+			// fallthrough
+		case REMOTE_MASK_GET:
+		case REMOTE_STORE:
+		case REMOTE_RESTORE:
+			transducer = _transducers.get( handle );
+			if( !transducer ) {
+				_error( op, handle, REMOTE_BAD_HANDLE );
+				return;
+			}
+			break;
+
+		case REMOTE_SET:
+			want = 1;
+			// fallthrough
+		case REMOTE_GET:
+		case REMOTE_LOCK:
+		case REMOTE_UNLOCK:
+			valve = _valves.get( handle );
+			if( !valve ) {
+				_error( op, handle, REMOTE_BAD_HANDLE );
+				return;
+			}
+			break;
+
+		default:
+			_error( op, handle, REMOTE_BAD_OP );
+			return;
+	}
+
+	if( length != want ) {
+		_error( op, handle, REMOTE_BAD_LENGTH );
+		return;
+	}
+
+	switch( op ) {
+
+		case REMOTE_MASK_SET: transducer->activeMask( _peek32( 4 ) ); break;
+		case REMOTE_STORE: transducer->store(); break;
+		case REMOTE_RESTORE: transducer->restore(); break;
+
+		case REMOTE_SET: valve->active( _peek( 4 ) ); break;
+		case REMOTE_LOCK: valve->lock(); break;
+		case REMOTE_UNLOCK: valve->unlock(); break;
+
+		default: break;
+	}
+
+	if( transducer ) _reply( op, handle, transducer->activeMask() );
+	else if( valve ) _reply( op, handle, *valve );
+	else _reply( op | REMOTE_REPLY, handle, NULL, 0 );
+}
+
+uint8_t Remote::frame( uint8_t *frame, uint8_t op, uint8_t handle,
+		const uint8_t *data, uint8_t length ) {
+
+	uint8_t check;
+
+	if( length > KNOBS_REMOTE_PAYLOAD ) length = KNOBS_REMOTE_PAYLOAD;
+
+	frame[ 0 ] = REMOTE_SYNC;
+	frame[ 1 ] = op;
+	frame[ 2 ] = handle;
+	frame[ 3 ] = length;
+
+	check = op + handle + length;
+
+	for( uint8_t i = 0; i < length; i++ ) {
+		frame[ 4+i ] = data[ i ];
+		check += data[ i ];
+	}
+
+	frame[ 4+length ] = -check;
+
+	return REMOTE_OVERHEAD + length;
+}
+
+void Remote::_reply( uint8_t op, uint8_t handle, const uint8_t *data, uint8_t length ) {
+
+	uint8_t buffer[ REMOTE_FRAME ];
+
+	if( !_send ) return;
+
+	_send( buffer, frame( buffer, op, handle, data, length ), _ctx );
+}
+
+void Remote::_reply( uint8_t op, uint8_t handle, uint32_t mask ) {
+
+	uint8_t data[ 4 ] = {
+		(uint8_t)mask, (uint8_t)( mask >> 8 ), (uint8_t)( mask >> 16 ), (uint8_t)( mask >> 24 )
+	};
+
+	_reply( op | REMOTE_REPLY, handle, data, 4 );
+}
+
+void Remote::_reply( uint8_t op, uint8_t handle, Valve &valve ) {
+
+	uint8_t state = ( valve.active() ? REMOTE_ACTIVE : 0 )
+			| ( valve.locked() ? REMOTE_LOCKED : 0 )
+			| ( valve.muted() ? REMOTE_MUTED : 0 );
+
+	_reply( op | REMOTE_REPLY, handle, &state, 1 );
+}
+
+void Remote::_error( uint8_t op, uint8_t handle, uint8_t error ) {
+
+	uint8_t data[ 2 ] = { op, error };
+
+	_reply( REMOTE_ERROR, handle, data, 2 );
+}
+
+#pragma GCC diagnostic pop
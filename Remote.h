@@ -0,0 +1,143 @@
+#ifndef REMOTE_H
+#define REMOTE_H
+
+#include "Valve.h"
+
+#include <stdint.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+// Bytes received but not yet executed. Must be a power of 2, max. 128
+#ifndef KNOBS_REMOTE_BUFFER
+	#define KNOBS_REMOTE_BUFFER 64
+#endif
+// Transducers and Valves which can be addressed. (each)
+#ifndef KNOBS_REMOTE_HANDLES
+	#define KNOBS_REMOTE_HANDLES 8
+#endif
+// Max. data bytes of one frame
+#ifndef KNOBS_REMOTE_PAYLOAD
+	#define KNOBS_REMOTE_PAYLOAD 8
+#endif
+
+#define REMOTE_SYNC 0xA5
+// sync, op, handle, length, check
+#define REMOTE_OVERHEAD 5
+#define REMOTE_FRAME ( REMOTE_OVERHEAD + KNOBS_REMOTE_PAYLOAD )
+
+namespace Knobs {
+
+	// Operations. Replies have the same op with REMOTE_REPLY set.
+	enum RemoteOp {
+		REMOTE_PING = 0x00,		// -
+		// on Transducer handles
+		REMOTE_MASK_SET = 0x01,	// mask (4 bytes LE) -> mask
+		REMOTE_MASK_GET = 0x02,	// - -> mask
+		REMOTE_STORE = 0x03,	// - -> mask
+		REMOTE_RESTORE = 0x04,	// - -> mask
+		// on Valve handles
+		REMOTE_SET = 0x10,		// on (1 byte) -> state
+		REMOTE_GET = 0x11,		// - -> state
+		REMOTE_LOCK = 0x12,		// - -> state
+		REMOTE_UNLOCK = 0x13,	// - -> state
+
+		REMOTE_REPLY = 0x80,
+		// reply to anything which failed: op, RemoteError
+		REMOTE_ERROR = 0xFF
+	};
+
+	enum RemoteError {
+		REMOTE_BAD_OP = 1,
+		REMOTE_BAD_HANDLE = 2,
+		REMOTE_BAD_LENGTH = 3
+	};
+
+	// Valve state in replies
+	enum RemoteState {
+		REMOTE_ACTIVE = 1,
+		REMOTE_LOCKED = 2,
+		REMOTE_MUTED = 4
+	};
+
+	// send a reply frame
+	typedef void (*remote_send_t)( const uint8_t *frame, uint8_t length, void *ctx );
+
+	// Remote: Binary command endpoint for Transducers and Valves.
+	//
+	// A frame is
+	//
+	//     REMOTE_SYNC op handle length data[length] check
+	//
+	// check makes the sum of op to check 0 (mod 256). Handles are the
+	// index of the Transducer or Valve in the order they were added, so
+	// nothing is looked up by name. Every frame is answered by a reply
+	// or REMOTE_ERROR frame. Frames with a bad check are skipped.
+	//
+	// Bytes are fed into a ring buffer (e.g. from the receive interrupt)
+	// and poll() executes complete frames right from there.
+	// Wait free for one feeding and one polling side like EventQueue.
+	class Remote {
+
+		private:
+			uint8_t _buffer[ KNOBS_REMOTE_BUFFER ];
+			uint8_t _head; // written by feeding side
+			uint8_t _tail; // written by polling side
+
+			Canister<Transducer, KNOBS_REMOTE_HANDLES> _transducers;
+			Canister<Valve, KNOBS_REMOTE_HANDLES> _valves;
+
+			remote_send_t _send;
+			void *_ctx;
+
+			uint16_t _errors;
+
+			inline uint8_t _peek( uint8_t i );
+			uint32_t _peek32( uint8_t i );
+
+			void _reply( uint8_t op, uint8_t handle, const uint8_t *data, uint8_t length );
+			void _reply( uint8_t op, uint8_t handle, uint32_t mask );
+			void _reply( uint8_t op, uint8_t handle, Valve &valve );
+			void _error( uint8_t op, uint8_t handle, uint8_t error );
+
+			void _execute( uint8_t op, uint8_t handle, uint8_t length );
+
+		public:
+			Remote();
+
+			// add Transducer/Valve. Handles count from 0 for each.
+			Remote& operator <<( Transducer &transducer );
+			Remote& operator <<( Valve &valve );
+
+			// where replies go
+			Remote& output( remote_send_t send, void *ctx=NULL );
+
+			// add received bytes. Returns false/amount taken if full.
+			bool feed( uint8_t byte );
+			int feed( const uint8_t *data, int length );
+
+			// contiguous free space to receive into directly. Call
+			// commit with the amount of bytes put there.
+			uint8_t *room( int &length );
+			void commit( int length );
+
+			// execute all complete frames. Returns amount executed.
+			int poll();
+
+			// bytes waiting
+			int fill();
+
+			// frames with bad check or length
+			uint16_t errors();
+
+			// build frame of op to handle with data into frame
+			// (REMOTE_FRAME bytes). Returns its length.
+			static uint8_t frame( uint8_t *frame, uint8_t op, uint8_t handle,
+					const uint8_t *data=NULL, uint8_t length=0 );
+	};
+}
+
+#pragma GCC diagnostic pop
+
+#endif
@@ -0,0 +1,106 @@
+#include "ShiftRegister.h"
+
+#include <Arduino.h>
+
+#ifdef KNOBS_SPI
+	#include <SPI.h>
+#endif
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+using namespace Knobs;
+
+/*****************************************************************************
+*
+*   S H I F T  R E G I S T E R
+*
+*****************************************************************************/
+
+ShiftRegister::ShiftRegister( const char *name, pin_t load, pin_t clock, pin_t data,
+		uint8_t chips )
+		: KnobBank( name )
+		, _load( load ), _clock( clock ), _data( data )
+		, _chips( chips*8 > KNOBS_BANK_WIDTH ? KNOBS_BANK_WIDTH/8 : chips )
+		{
+
+	_invert = false;
+
+	pinMode( load, OUTPUT );
+	pinMode( clock, OUTPUT );
+	pinMode( data, INPUT );
+
+	digitalWrite( load, HIGH );
+	digitalWrite( clock, LOW );
+}
+
+#ifdef KNOBS_SPI
+ShiftRegister::ShiftRegister( const char *name, pin_t load, uint8_t chips )
+		: KnobBank( name )
+		, _load( load ), _clock( KNOBS_NO_PIN ), _data( KNOBS_NO_PIN )
+		, _chips( chips*8 > KNOBS_BANK_WIDTH ? KNOBS_BANK_WIDTH/8 : chips )
+		{
+
+	_invert = false;
+
+	pinMode( load, OUTPUT );
+	digitalWrite( load, HIGH );
+}
+#endif
+
+ShiftRegister& ShiftRegister::invert( bool on ) {
+
+	_invert = on;
+
+	return *this;
+}
+
+// one chip's bits. First bit out is the MSB
+uint8_t ShiftRegister::_shift() {
+
+#ifdef KNOBS_SPI
+	if( _clock == KNOBS_NO_PIN ) return SPI.transfer( 0 );
+#endif
+
+	uint8_t bits = 0;
+
+	for( uint8_t i = 0; i < 8; i++ ) {
+
+		bits = ( bits << 1 ) | ( digitalRead( _data ) ? 1 : 0 );
+
+		digitalWrite( _clock, HIGH );
+		digitalWrite( _clock, LOW );
+	}
+
+	return bits;
+}
+
+bank_mask_t ShiftRegister::_sample() {
+
+	bank_mask_t raw = 0;
+
+	// latch all inputs
+	digitalWrite( _load, LOW );
+	digitalWrite( _load, HIGH );
+
+	for( uint8_t chip = 0; chip < _chips; chip++ ) {
+
+		uint8_t bits = _shift();
+
+		// first bit out is key 0
+		for( uint8_t i = 0; i < 8; i++, bits <<= 1 ) {
+
+			if( bits & 0x80 ) raw |= (bank_mask_t)1 << ( chip*8 + i );
+		}
+	}
+
+	if( !_invert ) return raw;
+
+	bank_mask_t used = _chips*8 == KNOBS_BANK_WIDTH ?
+			~(bank_mask_t)0 : ( (bank_mask_t)1 << _chips*8 ) - 1;
+
+	return ~raw & used;
+}
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,61 @@
+#ifndef SHIFTREGISTER_H
+#define SHIFTREGISTER_H
+
+#include "KnobBank.h"
+
+#include <stdint.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+namespace Knobs {
+
+	// ShiftRegister: Inputs of a chain of parallel in shift registers (74HC165).
+	//
+	// All bits are latched and clocked out at once every sample. The first
+	// bit clocked out is Key 0. With 74HC165s that is D7 of the chip next
+	// to the MCU: Its D7..D0 are Keys 0..7, D7..D0 of the next chip Keys
+	// 8..15 and so on. Keys are debounced together like in a KnobBank.
+	//
+	// The bits are shifted in by software. With KNOBS_SPI defined the
+	// constructor without clock and data pin uses the hardware SPI
+	// (SCK to CP, MISO to Q7) which must be set up with SPI.begin().
+	class ShiftRegister : public KnobBank {
+
+		private:
+
+			const pin_t _load;
+			const pin_t _clock;
+			const pin_t _data;
+			const uint8_t _chips;
+
+			bool _invert;
+
+			uint8_t _shift();
+
+		protected:
+
+			virtual bank_mask_t _sample();
+
+			// keys have no pins
+			virtual void _attach( PortSnapshot *snapshot ) {}
+
+		public:
+
+			// load: PL (active low), clock: CP, data: Q7.
+			// chips*8 must not exceed KNOBS_BANK_WIDTH
+			ShiftRegister( const char *name, pin_t load, pin_t clock, pin_t data,
+					uint8_t chips );
+#ifdef KNOBS_SPI
+			ShiftRegister( const char *name, pin_t load, uint8_t chips );
+#endif
+
+			// Keys are on when their input is low. (buttons with pullups)
+			ShiftRegister& invert( bool on );
+	};
+}
+
+#pragma GCC diagnostic pop
+
+#endif
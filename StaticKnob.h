@@ -0,0 +1,140 @@
+#ifndef STATICKNOB_H
+#define STATICKNOB_H
+
+#include "Knob.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+namespace Knobs {
+
+	// A list of handlers stored by value whose types are known at compile time.
+	// handle() and due() are called by qualified name, so choosing them needs
+	// no vtable. Their bodies are in Knob.cpp though and call back through
+	// Handler::_callback() (virtual) and a function pointer like on() does.
+	template <typename... Hs>
+	struct HandlerChain;
+
+	template <>
+	struct HandlerChain<> {
+
+		inline bool handle( Device &dev,
+				knob_value_t newState, knob_value_t oldState, knob_time_t time ) {
+			return true;
+		}
+
+		inline knob_time_t due( knob_value_t state, knob_time_t time ) {
+			return KNOB_TIME_NEVER;
+		}
+
+		inline uint8_t interest() {
+			return 0;
+		}
+	};
+
+	template <typename H, typename... Hs>
+	struct HandlerChain<H, Hs...> {
+
+		typedef H Head;
+		typedef HandlerChain<Hs...> Tail;
+
+		H head;
+		Tail tail;
+
+		HandlerChain( const H &h, const Hs&... hs ) : head( h ), tail( hs... ) {}
+
+		inline bool handle( Device &dev,
+				knob_value_t newState, knob_value_t oldState, knob_time_t time ) {
+
+			if( ( head.interest() & interestOf( newState, oldState ) )
+					&& !head.H::handle( dev, newState, oldState, time ) ) return false;
+
+			return tail.handle( dev, newState, oldState, time );
+		}
+
+		inline knob_time_t due( knob_value_t state, knob_time_t time ) {
+
+			knob_time_t mine = head.H::due( state, time ),
+			            others = tail.due( state, time );
+
+			return mine < others ? mine : others;
+		}
+
+		inline uint8_t interest() {
+			return head.interest() | tail.interest();
+		}
+	};
+
+	// N-th element of a HandlerChain
+	template <int N, typename C>
+	struct HandlerAt {
+
+		typedef typename HandlerAt<N-1, typename C::Tail>::type type;
+
+		static inline type &get( C &chain ) {
+			return HandlerAt<N-1, typename C::Tail>::get( chain.tail );
+		}
+	};
+
+	template <typename C>
+	struct HandlerAt<0, C> {
+
+		typedef typename C::Head type;
+
+		static inline type &get( C &chain ) {
+			return chain.head;
+		}
+	};
+
+	// StaticKnob: A Knob whose handlers are fixed at compile time.
+	//
+	//   StaticKnob<Push, Hold, Click> knob( "k", 3,
+	//           Push( onPush ), Hold( onHold, 500 ), Click( onClick ) );
+	//
+	// The handlers are copied into the knob. The Device reaches them with
+	// one virtual _handle() instead of walking its Canister, interests are
+	// known at construction. Callbacks are called as from on() (see
+	// HandlerChain), so this saves handler slots, not time per call.
+	// Handlers added with on() are run after them.
+	template <typename... Hs>
+	class StaticKnob : public Knob {
+
+		private:
+			HandlerChain<Hs...> _chain;
+
+		protected:
+			virtual bool _handle( knob_value_t newState,
+					knob_value_t oldState, knob_time_t time ) {
+
+				if( !_chain.handle( *this, newState, oldState, time ) ) return false;
+
+				return Knob::_handle( newState, oldState, time );
+			}
+
+			virtual knob_time_t _handlersDue( knob_value_t state, knob_time_t time ) {
+
+				knob_time_t mine = _chain.due( state, time ),
+				            others = Knob::_handlersDue( state, time );
+
+				return mine < others ? mine : others;
+			}
+
+		public:
+			StaticKnob( const char *name, pin_t pin, const Hs&... handlers )
+					: Knob( name, pin ), _chain( handlers... ) {
+
+				_interests( _chain.interest() );
+			}
+
+			// access N-th handler. e.g. knob.handler<1>().continues( true )
+			template <int N>
+			typename HandlerAt<N, HandlerChain<Hs...> >::type &handler() {
+				return HandlerAt<N, HandlerChain<Hs...> >::get( _chain );
+			}
+	};
+}
+
+#pragma GCC diagnostic pop
+
+#endif
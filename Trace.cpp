@@ -0,0 +1,209 @@
+#include "Trace.h"
+#include "Clock.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+#if KNOBS_TRACE
+
+#if KNOBS_TRACE & ( KNOBS_TRACE - 1 ) || KNOBS_TRACE > 4096
+	#error "KNOBS_TRACE must be a power of 2 not bigger than 4096"
+#endif
+
+#define _MASK ( KNOBS_TRACE - 1 )
+
+// Records may be made in interrupts. (see EventQueue)
+#define _LOAD( v ) __atomic_load_n( &(v), __ATOMIC_ACQUIRE )
+#define _STORE( v, n ) __atomic_store_n( &(v), (n), __ATOMIC_RELEASE )
+
+// AVR has no 32 bit atomics: Interrupts are blocked for those instead
+#ifdef __AVR__
+static inline uint32_t _load32( uint32_t &v ) {
+
+	knobs_irq_t irq;
+	uint32_t value;
+
+	KNOBS_LOCK( irq );
+	value = *(volatile uint32_t*)&v;
+	KNOBS_UNLOCK( irq );
+
+	return value;
+}
+
+static inline void _store32( uint32_t &v, uint32_t n ) {
+
+	knobs_irq_t irq;
+
+	KNOBS_LOCK( irq );
+	*(volatile uint32_t*)&v = n;
+	KNOBS_UNLOCK( irq );
+}
+
+static inline uint32_t _fetchAdd32( uint32_t &v, uint32_t n ) {
+
+	knobs_irq_t irq;
+	uint32_t was;
+
+	KNOBS_LOCK( irq );
+	was = *(volatile uint32_t*)&v;
+	*(volatile uint32_t*)&v = was + n;
+	KNOBS_UNLOCK( irq );
+
+	return was;
+}
+
+static inline uint32_t _exchange32( uint32_t &v, uint32_t n ) {
+
+	knobs_irq_t irq;
+	uint32_t was;
+
+	KNOBS_LOCK( irq );
+	was = *(volatile uint32_t*)&v;
+	*(volatile uint32_t*)&v = n;
+	KNOBS_UNLOCK( irq );
+
+	return was;
+}
+#else
+	#define _load32( v ) _LOAD( v )
+	#define _store32( v, n ) _STORE( v, n )
+	#define _fetchAdd32( v, n ) __atomic_fetch_add( &(v), (n), __ATOMIC_RELAXED )
+	#define _exchange32( v, n ) __atomic_exchange_n( &(v), (n), __ATOMIC_RELAXED )
+#endif
+
+using namespace Knobs;
+
+Trace Knobs::trace;
+
+/*****************************************************************************
+*
+*   T R A C E
+*
+*****************************************************************************/
+
+static inline int16_t _clip( int32_t value ) {
+
+	if( value > INT16_MAX ) return INT16_MAX;
+	if( value < INT16_MIN ) return INT16_MIN;
+	return value;
+}
+
+uint8_t Trace::enroll( const char *name ) {
+
+	if( _nNames >= KNOBS_TRACE_NAMES || _nNames >= TRACE_NO_ID ) return TRACE_NO_ID;
+
+	_names[ _nNames ] = name;
+
+	return _nNames++;
+}
+
+void Trace::record( uint8_t kind, uint8_t id, int32_t newValue, int32_t oldValue ) {
+
+	if( _LOAD( _paused ) ) {
+		_fetchAdd32( _lost, 1 );
+		return;
+	}
+
+	uint32_t now = clockRead(),
+	         delta = now - _exchange32( _last, now );
+
+	// an extra record for long pauses
+	uint8_t n = delta >= 0xffff ? 2 : 1;
+
+	uint32_t at = _fetchAdd32( _count, n );
+
+	if( n == 2 ) {
+
+		TraceRecord &time = _records[ at++ & _MASK ];
+
+		time.delta = 0xffff;
+		time.kind = TRACE_TIME;
+		time.id = TRACE_NO_ID;
+		time.newValue = delta >> 16;
+		time.oldValue = delta & 0xffff;
+
+		delta = 0;
+	}
+
+	TraceRecord &record = _records[ at & _MASK ];
+
+	record.delta = delta;
+	record.kind = kind;
+	record.id = id;
+	record.newValue = _clip( newValue );
+	record.oldValue = _clip( oldValue );
+}
+
+void Trace::dump( trace_write_t write, void *ctx ) {
+
+	uint32_t count, first, i;
+	uint16_t records;
+	uint8_t id, length;
+
+	_STORE( _paused, true );
+
+	count = _load32( _count );
+	records = count > KNOBS_TRACE ? KNOBS_TRACE : count;
+	first = count - records;
+
+	uint8_t header[] = {
+		TRACE_MAGIC[ 0 ], TRACE_MAGIC[ 1 ], TRACE_MAGIC[ 2 ], TRACE_MAGIC[ 3 ],
+		TRACE_VERSION,
+#ifdef KNOBS_MICROS
+		1,
+#else
+		0,
+#endif
+		_nNames,
+		(uint8_t)records, (uint8_t)( records >> 8 ),
+		(uint8_t)_lost, (uint8_t)( _lost >> 8 ), (uint8_t)( _lost >> 16 ), (uint8_t)( _lost >> 24 )
+	};
+
+	write( header, sizeof( header ), ctx );
+
+	for( id = 0; id < _nNames; id++ ) {
+
+		const char *name = _names[ id ] ? _names[ id ] : "";
+
+		length = strlen( name ) > 0xff ? 0xff : strlen( name );
+
+		uint8_t head[] = { id, length };
+
+		write( head, sizeof( head ), ctx );
+		write( (const uint8_t*)name, length, ctx );
+	}
+
+	// records are kept in little endian order on all supported targets
+	for( i = first; i < count; i++ ) {
+
+		write( (const uint8_t*)&_records[ i & _MASK ], sizeof( TraceRecord ), ctx );
+	}
+
+	_STORE( _paused, false );
+}
+
+void Trace::clear() {
+
+	_store32( _count, 0 );
+	_store32( _lost, 0 );
+}
+
+int Trace::fill() {
+
+	uint32_t count = _load32( _count );
+
+	return count > KNOBS_TRACE ? KNOBS_TRACE : count;
+}
+
+uint32_t Trace::lost() {
+
+	return _load32( _lost );
+}
+
+#endif
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,114 @@
+#ifndef KNOBS_TRACE_H
+#define KNOBS_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wpedantic"
+#pragma GCC diagnostic error "-Wreturn-type"
+
+#include "knobs_common.h"
+
+// Records kept by the trace. Must be a power of 2, max. 4096.
+// 0: No tracing. Nothing is compiled in.
+#ifndef KNOBS_TRACE
+	#define KNOBS_TRACE 0
+#endif
+// Devices and Valves which get an id of their own. Others share id 0xff
+#ifndef KNOBS_TRACE_NAMES
+	#define KNOBS_TRACE_NAMES 32
+#endif
+
+#define TRACE_MAGIC "KTRC"
+#define TRACE_VERSION 1
+#define TRACE_NO_ID 0xff
+
+#if KNOBS_TRACE
+	#define TRACE( kind, id, newValue, oldValue ) \
+		Knobs::trace.record( ( kind ), ( id ), ( newValue ), ( oldValue ) )
+	#define TRACE_ENROLL( name ) Knobs::trace.enroll( name )
+#else
+	#define TRACE( kind, id, newValue, oldValue )
+	#define TRACE_ENROLL( name ) TRACE_NO_ID
+#endif
+
+namespace Knobs {
+
+	enum TraceKind {
+		TRACE_TIME = 0,		// time passed. value: whole delta, delta: 0xffff
+		TRACE_ACTIVATE = 1,	// Device changed. value: new/old state
+		TRACE_FIRE = 2,		// Handler called back. value: state/HandlerType
+		TRACE_VALVE = 3		// Valve changed. value: new/old state
+	};
+
+	// One event. Values are saturated to 16 bits.
+	struct TraceRecord {
+		uint16_t delta;		// clock ticks since the record before
+		uint8_t kind;
+		uint8_t id;
+		int16_t newValue;
+		int16_t oldValue;
+	};
+
+	// write part of a dump
+	typedef void (*trace_write_t)( const uint8_t *data, uint16_t length, void *ctx );
+
+	// Trace: Flight recorder of activations, handler calls and Valve
+	// changes in RAM.
+	//
+	// Devices and Valves are enrolled with their names when constructed
+	// and record by id. The last KNOBS_TRACE records are kept. Recording
+	// may happen in interrupts and costs one clock read and 8 bytes of
+	// copying. So it can stay on in the field. (The delta of a record
+	// interrupted by another one may include the other's.)
+	//
+	// dump() writes (all little endian):
+	//
+	//     "KTRC" version units(0: ms, 1: us) names records(2 bytes) lost(4 bytes)
+	//     names times: id length name[length]
+	//     records times: TraceRecord, oldest first
+	//
+	// host/knobs_trace decodes dumps.
+	//
+	// Has no constructor: It is zero before any Device is constructed.
+	class Trace {
+
+		private:
+			TraceRecord _records[ KNOBS_TRACE ? KNOBS_TRACE : 1 ];
+			const char *_names[ KNOBS_TRACE_NAMES ];
+
+			// records ever made. The next one goes to _count % KNOBS_TRACE
+			uint32_t _count;
+			uint32_t _last;
+			uint32_t _lost;
+			uint8_t _nNames;
+			bool _paused;
+
+		public:
+
+			// get id for name. TRACE_NO_ID if there are too many.
+			uint8_t enroll( const char *name );
+
+			void record( uint8_t kind, uint8_t id, int32_t newValue, int32_t oldValue );
+
+			// write all records. Recording stops meanwhile.
+			void dump( trace_write_t write, void *ctx=NULL );
+
+			// forget all records
+			void clear();
+
+			// records kept
+			int fill();
+			// records not kept because of a dump running
+			uint32_t lost();
+	};
+
+#if KNOBS_TRACE
+	extern Trace trace;
+#endif
+}
+
+#pragma GCC diagnostic pop
+
+#endif
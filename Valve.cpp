@@ -16,6 +16,16 @@ Valve::Valve( const char * const name, pin_t pin ) : _name( name ), _pin( pin )
 	_inputWhenOff = false;
 	_mute = false;
 	_locked = false;
+
+	_slave = NULL;
+	_owner = NULL;
+	_listener = NULL;
+	_outlet = NULL;
+	_address = 0;
+
+#if KNOBS_TRACE
+	_traceId = TRACE_ENROLL( name );
+#endif
 }
 
 Valve& Valve::begin() {
@@ -25,16 +35,31 @@ Valve& Valve::begin() {
 
 void Valve::_init() {
 
+	if( _outlet ) {
+
+		_address = _outlet->address( _pin );
+
+		// mode and level at once. An outlet puts out nothing until
+		// written (e.g. the 74HC595 latch)
+		_outlet->hold();
+		_pinMode( _inputWhenOff ? _active : true );
+		_outlet->write( _address, _modify( _active ) );
+		_outlet->release();
+
+		return;
+	}
+
 	if( _inputWhenOff ) {
 		_pinMode( _active );
 	} else {
-		pinMode( _pin, OUTPUT );
+		_pinMode( true );
 	}
 }
 
 void Valve::_pinMode( bool to ) {
 
-	if( to ) pinMode( _pin, OUTPUT );
+	if( _outlet ) _outlet->mode( _address, to );
+	else if( to ) pinMode( _pin, OUTPUT );
 	else pinMode( _pin, INPUT );
 }
 
@@ -51,6 +76,11 @@ Valve& Valve::inputWhenOff( bool on ) {
 	_inputWhenOff = on;
 	return *this;
 }
+Valve& Valve::outlet( Outlet &outlet ) {
+	_outlet = &outlet;
+	_address = outlet.address( _pin );
+	return *this;
+}
 Valve& Valve::enslave( Valve &slave ) {
 	_slave = &slave;
 	return *this;
@@ -68,9 +98,19 @@ void Valve::_turn( bool on ) {
 
 	bool to = _modify( on );
 
-	if( _inputWhenOff ) _pinMode( to );
+	if( _outlet ) {
 
-	digitalWrite( _pin, to );
+		// the level is there when the pin becomes an output
+		_outlet->hold();
+		if( _inputWhenOff ) _pinMode( to );
+		_outlet->write( _address, to );
+		_outlet->release();
+
+	} else {
+
+		if( _inputWhenOff ) _pinMode( to );
+		digitalWrite( _pin, to );
+	}
 
 	if( _slave ) _slave->active( on );
 }
@@ -83,6 +123,8 @@ Valve& Valve::active( bool on, bool silent ) {
 	if( _owner ) on = _owner->onChange( *this, _active, on );
 	if( _listener && !silent ) _listener->onChange( *this, _active, on );
 
+	if( on != _active ) TRACE( TRACE_VALVE, _traceId, on, _active );
+
 	_active = on;
 
 	_turn( on );
@@ -162,6 +204,11 @@ void Valve::loop( knob_time_t time ) {
 	if( _owner ) _owner->onLoop( *this, time );
 }
 
+knob_time_t Valve::due( knob_time_t now ) {
+
+	return _owner ? _owner->due( *this, now ) : KNOB_TIME_NEVER;
+}
+
 Valve& Valve::_print( const char *msg, bool val ) {
 
 	Serial.print( msg );
@@ -182,64 +229,118 @@ Valve& Valve::_print( const char *msg, bool val ) {
  */
 
 Transducer::Transducer( const char *name )
-		: _name( name ) {}
+		: _name( name ), _nOutlets( 0 ), _usePorts( false ) {}
 Transducer::Transducer( const char *name, Valve &v1 )
-		: _name( name ) {
+		: _name( name ), _nOutlets( 0 ), _usePorts( false ) {
 	*this << v1;
 }
 Transducer::Transducer( const char *name, Valve &v1, Valve &v2 )
-		: _name( name ) {
+		: _name( name ), _nOutlets( 0 ), _usePorts( false ) {
 	*this << v1 << v2;
 }
 Transducer::Transducer( const char *name, Valve &v1, Valve &v2, Valve &v3 )
-		: _name( name ) {
+		: _name( name ), _nOutlets( 0 ), _usePorts( false ) {
 	*this << v1 << v2 << v3;
 }
 Transducer::Transducer( const char *name, Valve &v1, Valve &v2, Valve &v3,
 		Valve &v4 )
-		: _name( name ) {
+		: _name( name ), _nOutlets( 0 ), _usePorts( false ) {
 	*this << v1 << v2 << v3 << v4;
 }
 Transducer::Transducer( const char *name, Valve &v1, Valve &v2, Valve &v3,
 		Valve &v4, Valve &v5 )
-		: _name( name ) {
+		: _name( name ), _nOutlets( 0 ), _usePorts( false ) {
 	*this << v1 << v2 << v3 << v4 << v5;
 }
 Transducer::Transducer( const char *name, Valve &v1, Valve &v2, Valve &v3,
 		Valve &v4, Valve &v5, Valve &v6 )
-		: _name( name ) {
+		: _name( name ), _nOutlets( 0 ), _usePorts( false ) {
 	*this << v1 << v2 << v3 << v4 << v5 << v6;
 }
 Transducer::Transducer( const char *name, Valve &v1, Valve &v2, Valve &v3,
 		Valve &v4, Valve &v5, Valve &v6, Valve &v7 )
-		: _name( name ) {
+		: _name( name ), _nOutlets( 0 ), _usePorts( false ) {
 	*this << v1 << v2 << v3 << v4 << v5 << v6 << v7;
 }
 Transducer::Transducer( const char *name, Valve &v1, Valve &v2, Valve &v3,
 		Valve &v4, Valve &v5, Valve &v6, Valve &v7, Valve &v8 )
-		: _name( name ) {
+		: _name( name ), _nOutlets( 0 ), _usePorts( false ) {
 	*this << v1 << v2 << v3 << v4 << v5 << v6 << v7 << v8;
 }
 
 Transducer& Transducer::operator <<( Valve &valve ) {
 
 	_valves.add( valve );
+	_index.invalidate();
 	return *this;
 }
 
+bool Transducer::valves( Valve **storage, int capacity ) {
+
+	_index.invalidate();
+	return _valves.reserve( storage, capacity );
+}
+
+void Transducer::_hold() {
+
+	for( uint8_t i = 0; i < _nOutlets; i++ ) _outlets[ i ]->hold();
+}
+
+void Transducer::_release() {
+
+	for( uint8_t i = 0; i < _nOutlets; i++ ) _outlets[ i ]->release();
+}
+
 #define TONALL( m ) \
 			Valve *valve; \
-			for( valve=_valves.first(); valve; valve=_valves.next() ) { \
+			_hold(); \
+			for( Cursor<Valve> it( _valves ); ( valve = it.next() ); ) { \
 					valve->m(); \
-			}
+			} \
+			_release();
 #define TONALLP( m, p ) \
 			Valve *valve; \
-			for( valve=_valves.first(); valve; valve=_valves.next() ) { \
+			_hold(); \
+			for( Cursor<Valve> it( _valves ); ( valve = it.next() ); ) { \
 					valve->m( p ); \
-			}
+			} \
+			_release();
+
+Transducer& Transducer::usePorts( bool use ) {
+
+	_usePorts = use;
+	return *this;
+}
 
 Transducer& Transducer::begin() {
-	TONALL( begin );
+
+	Valve *valve;
+	uint8_t i;
+
+	_nOutlets = 0;
+
+	for( Cursor<Valve> it( _valves ); ( valve = it.next() ); ) {
+
+		if( _usePorts && !valve->_outlet && PortOutlet::supports( valve->_pin ) )
+				valve->_outlet = &_ports;
+
+		if( !valve->_outlet ) continue;
+
+		for( i = 0; i < _nOutlets; i++ ) if( _outlets[ i ] == valve->_outlet ) break;
+
+		if( i == _nOutlets && _nOutlets < KNOBS_TRANSDUCER_OUTLETS )
+				_outlets[ _nOutlets++ ] = valve->_outlet;
+	}
+
+	_hold();
+
+	for( Cursor<Valve> it( _valves ); ( valve = it.next() ); ) {
+
+		valve->begin();
+	}
+
+	_release();
+
 	return *this;
 }
 
@@ -281,7 +382,7 @@ Transducer& Transducer::unmute(){
 Transducer& Transducer::each( transducer_callback_t cb, knob_value_t val ) {
 
 	Valve *valve; \
-	for( valve=_valves.first(); valve; valve=_valves.next() ) {
+	for( Cursor<Valve> it( _valves ); ( valve = it.next() ); ) {
 
 		cb( *this, *valve, val );
 	}
@@ -293,24 +394,16 @@ Transducer& Transducer::active( const char *prefix, knob_value_t val ) {
 	unsigned int len = strlen( prefix );
 
 	Valve *valve; \
-	for( valve=_valves.first(); valve; valve=_valves.next() ) {
+	for( Cursor<Valve> it( _valves ); ( valve = it.next() ); ) {
 
 		if( strncmp( name(), prefix, len ) ) valve->active( val );
 	}
 	return *this;
 }
 */
-Valve* Transducer::find( const char *prefix ){
-
-	Valve *valve; \
-	for( valve=_valves.first(); valve; valve=_valves.next() ) {
-
-		const char *name = valve->name();
-		unsigned int len = strlen( name );
+Valve* Transducer::find( const char *query ){
 
-		if( strncmp( name, prefix, len ) == 0 ) return valve;
-	}
-	return NULL;
+	return _index.find( _valves, query );
 }
 
 int Transducer::fill() {
@@ -321,7 +414,7 @@ Transducer& Transducer::print() {
 
 	Serial.print( "| " );
 	Valve *valve; \
-	for( valve=_valves.first(); valve; valve=_valves.next() ) {
+	for( Cursor<Valve> it( _valves ); ( valve = it.next() ); ) {
 		Serial.print( valve->active() ? "X" : "o" );
 		Serial.print( " " );
 	}
@@ -334,11 +427,16 @@ Transducer& Transducer::activeMask( uint32_t mask ) {
 	Valve *valve;
 	int count = 1;
 
-	for( valve=_valves.first(); valve; valve=_valves.next() ) {
+	_hold();
+
+	for( Cursor<Valve> it( _valves ); ( valve = it.next() ); ) {
 
 		valve->active( mask & count );
 		count = count<<1;
 	}
+
+	_release();
+
 	return *this;
 }
 
@@ -348,7 +446,7 @@ uint32_t Transducer::activeMask() {
 	int count = 1;
 	Valve *valve;
 
-	for( valve=_valves.first(); valve; valve=_valves.next() ) {
+	for( Cursor<Valve> it( _valves ); ( valve = it.next() ); ) {
 
 		mask |= valve->active() ? count : 0;
 		count = count<<1;
@@ -389,15 +487,44 @@ const char * Transducer::name() {
 
 void Transducer::loop() {
 
+	loop( uptime() );
+}
+
+void Transducer::loop( knob_time_t now ) {
+
 	Valve *valve;
-	knob_time_t now = millis();
 
-	for( valve = _valves.first(); valve; valve = _valves.next() ) {
+	for( Cursor<Valve> it( _valves ); ( valve = it.next() ); ) {
 
 		valve->loop( now );
 	}
 }
 
+knob_time_t Transducer::due() {
+
+	Valve *valve;
+	knob_time_t now = uptime(),
+	            due, min = KNOB_TIME_NEVER;
+
+	for( Cursor<Valve> it( _valves ); ( valve = it.next() ); ) {
+
+		due = valve->due( now );
+		if( due < min ) min = due;
+	}
+
+	return min;
+}
+
+
+/*
+ * P R O F E S S O R
+ */
+
+knob_time_t Professor::due( Valve &valve, knob_time_t now ) {
+
+	return 0;
+}
+
 
 /*
  * T I M E D  P R O F E S S O R
@@ -426,7 +553,8 @@ void TimedProfessor::start() {
 
 	//Serial.println( "*T/start*" );
 
-	_startTime = millis();
+	// the clock starts at the next tick. See onLoop
+	_startTime = KNOB_TIME_NEVER;
 	_running = true;
 }
 
@@ -448,6 +576,8 @@ void TimedProfessor::onLoop( Valve &owner, knob_time_t time ) {
 
 	if( !_running ) return;
 
+	if( _startTime == KNOB_TIME_NEVER ) _startTime = time;
+
 	register knob_time_t end = _startTime + _holdTime;
 
 	if( _TIME( 0 ) ){
@@ -471,6 +601,41 @@ void TimedProfessor::onLoop( Valve &owner, knob_time_t time ) {
 	}
 }
 
+// next point in time where onLoop's decision changes. See _TIME
+knob_time_t TimedProfessor::due( Valve &owner, knob_time_t now ) {
+
+	if( !_running ) return KNOB_TIME_NEVER;
+
+	// not started yet
+	if( _startTime == KNOB_TIME_NEVER ) return 0;
+
+	knob_time_t end = _startTime + _holdTime,
+	            at[ 5 ],
+	            min = KNOB_TIME_NEVER;
+	int n = 0;
+
+	at[ n++ ] = end;
+	if( _secondWarning ) {
+		at[ n++ ] = end - _secondWarning + _TP_WARNING;
+		at[ n++ ] = end - _secondWarning;
+	}
+	if( _firstWarning ) {
+		at[ n++ ] = end - _firstWarning + _TP_WARNING;
+		at[ n++ ] = end - _firstWarning;
+	}
+
+	for( int i = 0; i < n; i++ ) {
+
+		// condition is 'time > end - val'
+		knob_time_t wait = at[ i ] + 1 - now;
+
+		if( wait > 0 && wait < min ) min = wait;
+	}
+
+	// everything passed: switch off is overdue
+	return min == KNOB_TIME_NEVER ? 0 : min;
+}
+
 bool TimedProfessor::onChange( Valve &owner, knob_value_t oldVal, knob_value_t newVal ) {
 
 	/*
@@ -509,7 +674,7 @@ void TimedValve::keep() {
 	_timer.stop();
 
 	mute( false );
-	delay( _TP_WARNING );
+	delay( _TP_WARNING / _MS( 1 ) );
 	unmute();
 }
 
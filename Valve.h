@@ -8,15 +8,23 @@
 #pragma GCC diagnostic error "-Wreturn-type"
 
 #include "knobs_common.h"
+#include "Clock.h"
 #include "Canister.h"
 #include "algorithm.h"
+#include "Outlet.h"
+#include "NameIndex.h"
+#include "Trace.h"
 
 #ifndef KNOBS_TRANSDUCER_CANISTER_SIZE
 	#define KNOBS_TRANSDUCER_CANISTER_SIZE 20
 #endif
+// Different Outlets per Transducer
+#ifndef KNOBS_TRANSDUCER_OUTLETS
+	#define KNOBS_TRANSDUCER_OUTLETS 4
+#endif
 
-#define _SEC(n) ((n)*1000)
-#define _MS(n) (n)
+#define _SEC(n) KNOB_SEC(n)
+#define _MS(n) KNOB_MS(n)
 
 #define _TP_FIRST_WARNING _SEC( 10 )
 #define _TP_SECOND_WARNING _SEC( 3 )
@@ -56,9 +64,15 @@ namespace Knobs {
 			bool _mute : 1;
 			bool _locked : 1;
 
+#if KNOBS_TRACE
+			uint8_t _traceId;
+#endif
+
 			Valve *_slave;
 			Professor *_owner;
 			Buttler *_listener;
+			Outlet *_outlet;
+			outlet_addr_t _address;
 
 			void _init();
 			void _turn( bool on );
@@ -79,6 +93,8 @@ namespace Knobs {
 			Valve &invert( bool on );
 			// Turn pin to input when set to false
 			Valve &inputWhenOff( bool on );
+			// Put state to pin of outlet instead of the MCU's pin
+			Valve &outlet( Outlet &outlet );
 
 			// start controlling other valve when this on is operated
 			Valve &enslave( Valve &slave );
@@ -125,6 +141,9 @@ namespace Knobs {
 
 			// call periodically in main loop. calls should be every 50ms or quicker
 			virtual void loop( knob_time_t time );
+
+			// time until loop must be called again
+			knob_time_t due( knob_time_t now );
 	};
 
 	// Transducers combine multiple Valves
@@ -134,6 +153,19 @@ namespace Knobs {
 			const char *_name;
 
 			Canister<Valve, KNOBS_TRANSDUCER_CANISTER_SIZE> _valves;
+			NameIndex<Valve, KNOBS_NAME_INDEX> _index;
+
+			// Outlets of the Valves. Held during operations on all
+			// Valves so they are written at once.
+			Outlet *_outlets[ KNOBS_TRANSDUCER_OUTLETS ];
+			uint8_t _nOutlets;
+
+			// Valves on pins of the MCU are written by port if _usePorts
+			PortOutlet _ports;
+			bool _usePorts;
+
+			void _hold();
+			void _release();
 
 		public:
 
@@ -153,7 +185,17 @@ namespace Knobs {
 			// Add another Valve
 			Transducer& operator<<( Valve &valve );
 
+			// keep valves in storage for up to capacity valves instead of
+			// the built in KNOBS_TRANSDUCER_CANISTER_SIZE. Returns false if too small.
+			bool valves( Valve **storage, int capacity );
+
+			// write Valves on pins of the MCU without an Outlet of their
+			// own by port, so they switch at once. See PortOutlet.
+			// Off by default. Call before begin().
+			Transducer& usePorts( bool use=true );
+
 			// Start operation. (calls Valves' begin)
+			// Add Valves and set their Outlets before.
 			Transducer& begin();
 
 			// Turn on/off all Valves
@@ -167,8 +209,9 @@ namespace Knobs {
 
 			// Iterate all Valves and call cb on them
 			Transducer& each( transducer_callback_t cb, knob_value_t val=0 );
-			// Find one valve by prefix
-			Valve* find( const char *prefix );
+			// Find the first Valve whose name is a prefix of query.
+			// Uses an index if KNOBS_NAME_INDEX is set.
+			Valve* find( const char *query );
 
 			// Set valve state my mask
 			Transducer& activeMask( uint32_t mask );
@@ -201,6 +244,12 @@ namespace Knobs {
 
 			// call periodically in main loop. calls should be every 50ms or quicker
 			void loop();
+			// same with the time of this tick
+			void loop( knob_time_t now );
+
+			// time until loop must be called again. KNOB_TIME_NEVER if
+			// no Professor has something planned.
+			knob_time_t due();
 	};
 
 	// Operation can be handed over to an (Mad) Scientist
@@ -211,6 +260,10 @@ namespace Knobs {
 		public:
 			virtual void onLoop( Valve &valve, knob_time_t time ) = 0;
 			virtual bool onChange( Valve &valve, knob_value_t oldVal, knob_value_t newVal ) = 0;
+
+			// time until onLoop must be called again.
+			// Default is 0 which means: call continuously.
+			virtual knob_time_t due( Valve &valve, knob_time_t now );
 	};
 
 	// A Buttler can look at the Valve and to stuff when it's
@@ -245,6 +298,7 @@ namespace Knobs {
 		public:
 			virtual void onLoop( Valve &owner, knob_time_t time );
 			virtual bool onChange( Valve &owner, knob_value_t oldVal, knob_value_t newVal );
+			virtual knob_time_t due( Valve &owner, knob_time_t now );
 	};
 
 	// TimedValve is operated by a TimedProfessor and automagically turns off after
@@ -0,0 +1,95 @@
+#include "Arduino.h"
+
+#include "Hal.h"
+
+#include <stdio.h>
+
+using namespace Knobs;
+
+void pinMode( uint8_t pin, uint8_t mode ) {
+	Host::hal().pinMode( pin, mode );
+}
+int digitalRead( uint8_t pin ) {
+	return Host::hal().digitalRead( pin );
+}
+void digitalWrite( uint8_t pin, uint8_t val ) {
+	Host::hal().digitalWrite( pin, val );
+}
+int analogRead( uint8_t pin ) {
+	return Host::hal().analogRead( pin );
+}
+volatile uint8_t *_hostPortInputRegister( uint8_t port ) {
+	return Host::hal().inputRegister( port );
+}
+volatile uint8_t *_hostPortOutputRegister( uint8_t port ) {
+	return Host::hal().outputRegister( port );
+}
+volatile uint8_t *_hostPortModeRegister( uint8_t port ) {
+	return Host::hal().modeRegister( port );
+}
+void _hostPortWritten( uint8_t port ) {
+	Host::hal().registersWritten( port );
+}
+
+void attachInterrupt( uint8_t num, void (*isr)(), int mode ) {
+	Host::hal().attachInterrupt( num, isr, mode );
+}
+void detachInterrupt( uint8_t num ) {
+	Host::hal().attachInterrupt( num, NULL, 0 );
+}
+
+// Like on the real thing these are 32 bit and wrap around.
+unsigned long millis() {
+	Host::hal().tick();
+	return (uint32_t)( Host::clock().micros() / 1000 );
+}
+unsigned long micros() {
+	Host::hal().tick();
+	return (uint32_t)Host::clock().micros();
+}
+
+void delay( unsigned long ms ) {
+	Host::clock().sleep( (uint64_t)ms * 1000 );
+}
+void delayMicroseconds( unsigned int us ) {
+	Host::clock().sleep( us );
+}
+
+
+/*
+ * S E R I A L
+ */
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin( unsigned long baud ) {}
+
+size_t HardwareSerial::write( uint8_t c ) {
+	return fputc( c, stdout ) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::print( const char *str ) {
+	return printf( "%s", str );
+}
+size_t HardwareSerial::print( char c ) {
+	return write( c );
+}
+size_t HardwareSerial::print( int val ) {
+	return printf( "%d", val );
+}
+size_t HardwareSerial::print( unsigned int val ) {
+	return printf( "%u", val );
+}
+size_t HardwareSerial::print( long val ) {
+	return printf( "%ld", val );
+}
+size_t HardwareSerial::print( unsigned long val ) {
+	return printf( "%lu", val );
+}
+size_t HardwareSerial::print( double val ) {
+	return printf( "%.2f", val );
+}
+
+size_t HardwareSerial::println() {
+	return print( "\r\n" );
+}
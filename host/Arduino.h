@@ -0,0 +1,89 @@
+#ifndef KNOBS_HOST_ARDUINO_H
+#define KNOBS_HOST_ARDUINO_H
+
+/*
+ * Minimal replacement of the Arduino core for building Knobs on the host.
+ * Only what the library uses is provided. Everything is routed to
+ * Knobs::Host (see Hal.h).
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+void pinMode( uint8_t pin, uint8_t mode );
+int digitalRead( uint8_t pin );
+void digitalWrite( uint8_t pin, uint8_t val );
+int analogRead( uint8_t pin );
+
+// Port access like on AVR. Pin p is bit p%8 of port p/8+1.
+#define NOT_A_PORT 0
+#define digitalPinToPort( P ) ( (uint8_t)( (P)/8 + 1 ) )
+#define digitalPinToBitMask( P ) ( (uint8_t)( 1 << ( (P)%8 ) ) )
+#define portInputRegister( P ) _hostPortInputRegister( P )
+#define portOutputRegister( P ) _hostPortOutputRegister( P )
+#define portModeRegister( P ) _hostPortModeRegister( P )
+// Not Arduino: the pins follow what was written to the output and mode
+// register of port P.
+#define portWritten( P ) _hostPortWritten( P )
+
+volatile uint8_t *_hostPortInputRegister( uint8_t port );
+volatile uint8_t *_hostPortOutputRegister( uint8_t port );
+volatile uint8_t *_hostPortModeRegister( uint8_t port );
+void _hostPortWritten( uint8_t port );
+
+// Every pin can trigger an interrupt. See SimHal.
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt( P ) ( (int)(P) )
+
+void attachInterrupt( uint8_t num, void (*isr)(), int mode );
+void detachInterrupt( uint8_t num );
+
+// There is only one thread
+#define interrupts()
+#define noInterrupts()
+
+unsigned long millis();
+unsigned long micros();
+void delay( unsigned long ms );
+void delayMicroseconds( unsigned int us );
+
+// Serial output goes to stdout
+class HardwareSerial {
+
+	public:
+		void begin( unsigned long baud );
+
+		size_t write( uint8_t c );
+
+		size_t print( const char *str );
+		size_t print( char c );
+		size_t print( int val );
+		size_t print( unsigned int val );
+		size_t print( long val );
+		size_t print( unsigned long val );
+		size_t print( double val );
+
+		size_t println();
+		template <typename T>
+		size_t println( T val ) {
+			size_t n = print( val );
+			return n + println();
+		}
+};
+
+extern HardwareSerial Serial;
+
+#endif
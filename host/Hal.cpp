@@ -0,0 +1,391 @@
+#include "Hal.h"
+
+#include "Arduino.h"
+#include "Clock.h"
+
+#include <time.h>
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+/*****************************************************************************
+*
+*   C L O C K
+*
+*****************************************************************************/
+
+static uint64_t _monotonic() {
+
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+SystemClock::SystemClock() {
+
+	_start = _monotonic();
+}
+
+uint64_t SystemClock::micros() {
+
+	return _monotonic() - _start;
+}
+
+void SystemClock::sleep( uint64_t us ) {
+
+	struct timespec ts;
+
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = ( us % 1000000 ) * 1000;
+
+	while( nanosleep( &ts, &ts ) != 0 );
+}
+
+VirtualClock::VirtualClock( uint64_t start ) : _now( start ) {}
+
+VirtualClock& VirtualClock::advance( knob_time_t ms ) {
+
+	_now += ms * 1000;
+
+	return *this;
+}
+
+VirtualClock& VirtualClock::advanceMicros( uint64_t us ) {
+
+	_now += us;
+
+	return *this;
+}
+
+VirtualClock& VirtualClock::set( uint64_t us ) {
+
+	_now = us;
+
+	return *this;
+}
+
+uint64_t VirtualClock::micros() {
+
+	return _now;
+}
+
+void VirtualClock::sleep( uint64_t us ) {
+
+	_now += us;
+}
+
+
+/*****************************************************************************
+*
+*   H A L
+*
+*****************************************************************************/
+
+volatile uint8_t *Hal::inputRegister( uint8_t port ) {
+
+	if( port == NOT_A_PORT || port >= KNOBS_HOST_PORTS ) return NULL;
+
+	uint8_t val = 0;
+	pin_t pin = ( port-1 ) * 8;
+
+	for( uint8_t bit = 0; bit < 8; bit++ ) {
+		if( digitalRead( pin + bit ) ) val |= 1 << bit;
+	}
+
+	_port[ port ] = val;
+
+	return &_port[ port ];
+}
+
+volatile uint8_t *Hal::outputRegister( uint8_t port ) {
+
+	if( port == NOT_A_PORT || port >= KNOBS_HOST_PORTS ) return NULL;
+
+	uint8_t val = 0;
+	pin_t pin = ( port-1 ) * 8;
+
+	for( uint8_t bit = 0; bit < 8; bit++ ) {
+		if( output( pin + bit ) ) val |= 1 << bit;
+	}
+
+	_out[ port ] = val;
+	_outWas[ port ] = val;
+
+	return &_out[ port ];
+}
+
+volatile uint8_t *Hal::modeRegister( uint8_t port ) {
+
+	if( port == NOT_A_PORT || port >= KNOBS_HOST_PORTS ) return NULL;
+
+	uint8_t val = 0;
+	pin_t pin = ( port-1 ) * 8;
+
+	for( uint8_t bit = 0; bit < 8; bit++ ) {
+		if( mode( pin + bit ) == OUTPUT ) val |= 1 << bit;
+	}
+
+	_ddr[ port ] = val;
+	_ddrWas[ port ] = val;
+
+	return &_ddr[ port ];
+}
+
+void Hal::registersWritten( uint8_t port ) {
+
+	if( port == NOT_A_PORT || port >= KNOBS_HOST_PORTS ) return;
+
+	pin_t pin = ( port-1 ) * 8;
+	uint8_t out = _out[ port ] ^ _outWas[ port ],
+	        ddr = _ddr[ port ] ^ _ddrWas[ port ];
+
+	// levels first like the port does. Outputs switch on with theirs
+	for( uint8_t bit = 0; bit < 8; bit++ ) {
+		if( out & 1 << bit ) digitalWrite( pin + bit, _out[ port ] & 1 << bit ? HIGH : LOW );
+	}
+	for( uint8_t bit = 0; bit < 8; bit++ ) {
+		if( ddr & 1 << bit ) pinMode( pin + bit, _ddr[ port ] & 1 << bit ? OUTPUT : INPUT );
+	}
+
+	_outWas[ port ] = _out[ port ];
+	_ddrWas[ port ] = _ddr[ port ];
+}
+
+
+/*****************************************************************************
+*
+*   S C R I P T
+*
+*****************************************************************************/
+
+Script::Script( const PinEvent *events, int count )
+		: _events( events ), _count( count ) {
+
+	_pos = 0;
+}
+
+Script& Script::rewind() {
+
+	_pos = 0;
+
+	return *this;
+}
+
+bool Script::done() {
+
+	return _pos >= _count;
+}
+
+knob_time_t Script::next() {
+
+	return done() ? -1 : _events[ _pos ].time;
+}
+
+void Script::apply( SimHal &target, knob_time_t now ) {
+
+	while( _pos < _count && _events[ _pos ].time <= now ) {
+
+		const PinEvent &ev = _events[ _pos++ ];
+
+		target.input( ev.pin, ev.value );
+	}
+}
+
+
+/*****************************************************************************
+*
+*   S I M  H A L
+*
+*****************************************************************************/
+
+SimHal::SimHal() {
+
+	_script = NULL;
+	_applying = false;
+	_cb = NULL;
+
+	reset();
+}
+
+SimHal& SimHal::reset() {
+
+	memset( _mode, INPUT, sizeof( _mode ) );
+	memset( _driven, 0, sizeof( _driven ) );
+	memset( _input, 0, sizeof( _input ) );
+	memset( _output, 0, sizeof( _output ) );
+	memset( _writes, 0, sizeof( _writes ) );
+	memset( _isr, 0, sizeof( _isr ) );
+	memset( _isrMode, 0, sizeof( _isrMode ) );
+
+	_script = NULL;
+	_cb = NULL;
+
+	return *this;
+}
+
+SimHal& SimHal::input( pin_t pin, value_t value ) {
+
+	if( pin >= KNOBS_HOST_PINS ) return *this;
+
+	int before = _level( pin );
+
+	_input[ pin ] = value;
+	_driven[ pin ] = true;
+
+	int after = _level( pin );
+
+	// keep the port register live like on hardware. (ISRs read it directly)
+	if( before != after ) inputRegister( digitalPinToPort( pin ) );
+
+	if( _isr[ pin ] && before != after ) {
+
+		if( _isrMode[ pin ] == CHANGE
+				|| ( _isrMode[ pin ] == RISING && after )
+				|| ( _isrMode[ pin ] == FALLING && !after ) ) _isr[ pin ]();
+	}
+
+	return *this;
+}
+
+SimHal& SimHal::release( pin_t pin ) {
+
+	if( pin >= KNOBS_HOST_PINS ) return *this;
+
+	_driven[ pin ] = false;
+
+	return *this;
+}
+
+SimHal& SimHal::script( Script &script ) {
+
+	_script = &script;
+
+	return *this;
+}
+
+SimHal& SimHal::onOutput( output_callback_t cb ) {
+
+	_cb = cb;
+
+	return *this;
+}
+
+uint8_t SimHal::output( pin_t pin ) {
+
+	return pin < KNOBS_HOST_PINS ? _output[ pin ] : 0;
+}
+
+uint32_t SimHal::writes( pin_t pin ) {
+
+	return pin < KNOBS_HOST_PINS ? _writes[ pin ] : 0;
+}
+
+uint8_t SimHal::mode( pin_t pin ) {
+
+	return pin < KNOBS_HOST_PINS ? _mode[ pin ] : INPUT;
+}
+
+void SimHal::_apply() {
+
+	// interrupts triggered by the script read the time, too
+	if( !_script || _applying ) return;
+
+	_applying = true;
+	_script->apply( *this, Host::now() );
+	_applying = false;
+}
+
+int SimHal::_level( pin_t pin ) {
+
+	if( _driven[ pin ] ) return _input[ pin ] ? HIGH : LOW;
+
+	// floating pins read low unless pulled up
+	return _mode[ pin ] == INPUT_PULLUP ? HIGH : LOW;
+}
+
+void SimHal::pinMode( pin_t pin, uint8_t mode ) {
+
+	if( pin >= KNOBS_HOST_PINS ) return;
+
+	_mode[ pin ] = mode;
+}
+
+int SimHal::digitalRead( pin_t pin ) {
+
+	if( pin >= KNOBS_HOST_PINS ) return LOW;
+
+	_apply();
+
+	return _level( pin );
+}
+
+void SimHal::digitalWrite( pin_t pin, uint8_t val ) {
+
+	if( pin >= KNOBS_HOST_PINS ) return;
+
+	_output[ pin ] = val ? HIGH : LOW;
+	_writes[ pin ]++;
+
+	if( _cb ) _cb( pin, _output[ pin ], Host::now() );
+}
+
+int SimHal::analogRead( pin_t pin ) {
+
+	if( pin >= KNOBS_HOST_PINS ) return 0;
+
+	_apply();
+
+	return _driven[ pin ] ? _input[ pin ] : 0;
+}
+
+void SimHal::attachInterrupt( pin_t pin, isr_t isr, int mode ) {
+
+	if( pin >= KNOBS_HOST_PINS ) return;
+
+	_isr[ pin ] = isr;
+	_isrMode[ pin ] = mode;
+}
+
+void SimHal::tick() {
+
+	_apply();
+}
+
+
+/*****************************************************************************
+*
+*   B A C K E N D S
+*
+*****************************************************************************/
+
+// Devices are usually global and call pinMode in their constructors.
+// So the defaults are created on first use.
+static Hal *_hal = NULL;
+static Clock *_clock = NULL;
+
+void Host::use( Hal &hal ) {
+	_hal = &hal;
+}
+void Host::use( Clock &clock ) {
+	_clock = &clock;
+	// the new clock starts elsewhere. Don't take it for a wrap.
+	clockSource( NULL );
+}
+
+Hal& Host::hal() {
+	return _hal ? *_hal : sim();
+}
+Clock& Host::clock() {
+	static SystemClock system;
+	return _clock ? *_clock : system;
+}
+SimHal& Host::sim() {
+	static SimHal sim;
+	return sim;
+}
+
+knob_time_t Host::now() {
+	return KNOB_US( clock().micros() );
+}
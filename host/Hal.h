@@ -0,0 +1,217 @@
+#ifndef KNOBS_HOST_HAL_H
+#define KNOBS_HOST_HAL_H
+
+/*
+ * Host side hardware abstraction.
+ *
+ * Replaces the Arduino core when the library is built on Linux.
+ * All Arduino calls (see Arduino.h in this folder) are forwarded
+ * to the currently used Hal and Clock which can be exchanged at runtime.
+ */
+
+#include <stdint.h>
+
+#include "knobs_common.h"
+
+#ifndef KNOBS_HOST_PINS
+	#define KNOBS_HOST_PINS 64
+#endif
+#define KNOBS_HOST_PORTS ( KNOBS_HOST_PINS/8 + 1 )
+
+namespace Knobs {
+namespace Host {
+
+	// Source of time. All times are in microseconds.
+	class Clock {
+
+		public:
+			// return time since start
+			virtual uint64_t micros() = 0;
+
+			// wait for the given time
+			virtual void sleep( uint64_t us ) = 0;
+	};
+
+	// Real time using the systems monotonic clock
+	class SystemClock : public Clock {
+
+		private:
+			uint64_t _start;
+
+		public:
+			SystemClock();
+
+			virtual uint64_t micros();
+			virtual void sleep( uint64_t us );
+	};
+
+	// Time which only advances when told so.
+	// delay() returns immediately so simulations run as fast as the cpu can.
+	class VirtualClock : public Clock {
+
+		private:
+			uint64_t _now;
+
+		public:
+			VirtualClock( uint64_t start=0 );
+
+			// advance by ms
+			VirtualClock& advance( knob_time_t ms );
+			// advance by us
+			VirtualClock& advanceMicros( uint64_t us );
+			// jump to absolute time in us
+			VirtualClock& set( uint64_t us );
+
+			virtual uint64_t micros();
+			virtual void sleep( uint64_t us );
+	};
+
+	typedef void (*isr_t)();
+
+	// Pin access. Implement this in order to run on other backends.
+	// Pins are grouped in ports of 8 like on AVR: pin p is bit p%8 of port p/8+1.
+	class Hal {
+
+		private:
+			volatile uint8_t _port[ KNOBS_HOST_PORTS ];
+			volatile uint8_t _out[ KNOBS_HOST_PORTS ];
+			volatile uint8_t _ddr[ KNOBS_HOST_PORTS ];
+			// _out and _ddr as handed out
+			uint8_t _outWas[ KNOBS_HOST_PORTS ];
+			uint8_t _ddrWas[ KNOBS_HOST_PORTS ];
+
+		public:
+			virtual void pinMode( pin_t pin, uint8_t mode ) = 0;
+			virtual int digitalRead( pin_t pin ) = 0;
+			virtual void digitalWrite( pin_t pin, uint8_t val ) = 0;
+			virtual int analogRead( pin_t pin ) = 0;
+
+			// return input register of port. Default implementation
+			// assembles it using digitalRead.
+			virtual volatile uint8_t *inputRegister( uint8_t port );
+
+			// return output and mode register of port. Default implementation
+			// assembles them using output() and mode(). What is written to
+			// them goes to the pins (the changed bits only) with registersWritten().
+			virtual volatile uint8_t *outputRegister( uint8_t port );
+			virtual volatile uint8_t *modeRegister( uint8_t port );
+			virtual void registersWritten( uint8_t port );
+
+			// last value written to pin and its mode. For the port registers.
+			virtual uint8_t output( pin_t pin ) { return 0; }
+			virtual uint8_t mode( pin_t pin ) { return 0; }
+
+			// set (or remove with isr NULL) interrupt on pin.
+			// Default implementation doesn't support interrupts.
+			virtual void attachInterrupt( pin_t pin, isr_t isr, int mode ) {}
+
+			// called whenever the library reads the time
+			virtual void tick() {}
+	};
+
+	class SimHal;
+
+	// One scripted change of an input pin. time is in knob units, see KNOB_MS().
+	struct PinEvent {
+		knob_time_t time;
+		pin_t pin;
+		value_t value;
+	};
+
+	// A list of input changes which are applied as the clock advances.
+	// Events must be sorted by time.
+	class Script {
+
+		private:
+			const PinEvent *_events;
+			const int _count;
+			int _pos;
+
+		public:
+			Script( const PinEvent *events, int count );
+
+			// start over
+			Script& rewind();
+			// true if all events are applied
+			bool done();
+			// time of next event or -1 if done
+			knob_time_t next();
+
+			// apply all events until 'now'
+			void apply( SimHal &target, knob_time_t now );
+	};
+
+	typedef void (*output_callback_t)( pin_t pin, value_t value, knob_time_t time );
+
+	// Simulated pins.
+	// Inputs are set from the test or from a Script.
+	// Outputs are captured and can be inspected or reported via callback.
+	class SimHal : public Hal {
+
+		private:
+			uint8_t _mode[ KNOBS_HOST_PINS ];
+			bool _driven[ KNOBS_HOST_PINS ];
+			value_t _input[ KNOBS_HOST_PINS ];
+			uint8_t _output[ KNOBS_HOST_PINS ];
+			uint32_t _writes[ KNOBS_HOST_PINS ];
+
+			isr_t _isr[ KNOBS_HOST_PINS ];
+			uint8_t _isrMode[ KNOBS_HOST_PINS ];
+
+			Script *_script;
+			bool _applying;
+			output_callback_t _cb;
+
+			void _apply();
+			int _level( pin_t pin );
+
+		public:
+			SimHal();
+
+			// forget everything
+			SimHal& reset();
+
+			// set input pin to value (digital: 0/1, analog: 0..1023)
+			// Calls attached interrupt if the level changes like it would
+			// happen on the real thing.
+			SimHal& input( pin_t pin, value_t value );
+			// release input. It is floating (or pulled up) afterwards
+			SimHal& release( pin_t pin );
+
+			// use script for inputs
+			SimHal& script( Script &script );
+			// get notified on every digitalWrite
+			SimHal& onOutput( output_callback_t cb );
+
+			// last value written to pin
+			virtual uint8_t output( pin_t pin );
+			// amount of writes to pin
+			uint32_t writes( pin_t pin );
+			// current pin mode
+			virtual uint8_t mode( pin_t pin );
+
+			virtual void pinMode( pin_t pin, uint8_t mode );
+			virtual int digitalRead( pin_t pin );
+			virtual void digitalWrite( pin_t pin, uint8_t val );
+			virtual int analogRead( pin_t pin );
+
+			virtual void attachInterrupt( pin_t pin, isr_t isr, int mode );
+			virtual void tick();
+	};
+
+	// exchange the backends. Defaults are a SimHal and a SystemClock.
+	// Exchanging the clock resets uptime() (and its clockSource()).
+	void use( Hal &hal );
+	void use( Clock &clock );
+
+	Hal &hal();
+	Clock &clock();
+	// default simulated hal
+	SimHal &sim();
+
+	// current time in knob units (ms, or us with KNOBS_MICROS) as seen by the library
+	knob_time_t now();
+}
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef KNOBS_HOST_HANDLERNAMES_H
+#define KNOBS_HOST_HANDLERNAMES_H
+
+#include "Knob.h"
+
+namespace Knobs {
+namespace Host {
+
+	// name of HandlerType for logs
+	inline const char *handlerName( int type ) {
+
+		switch( type ) {
+			case HT_ALWAYS: return "always";
+			case HT_PUSH: return "push";
+			case HT_RELEASE: return "release";
+			case HT_HOLD: return "hold";
+			case HT_CLICK: return "click";
+			case HT_TOGGLE: return "toggle";
+			case HT_DOUBLECLICK: return "doubleclick";
+			case HT_MULTICLICK: return "multiclick";
+			case HT_CHANGE: return "change";
+			case HT_RISE: return "rise";
+			case HT_FALL: return "fall";
+			case HT_OVER: return "over";
+			case HT_UNDER: return "under";
+			case HT_HYSTERESIS: return "hysteresis";
+			case HT_TRANSPORT: return "transport";
+		}
+		return "?";
+	}
+}
+}
+
+#endif
@@ -0,0 +1,326 @@
+#include "Reactor.h"
+
+#include "Hal.h"
+#include "Arduino.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <linux/gpio.h>
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+#define _EVENTS 8
+
+Reactor::Reactor() {
+
+	struct epoll_event ev;
+
+	_period = KNOB_MS( 1 );
+
+	for( int i = 0; i < KNOBS_REACTOR_WATCHES; i++ ) _watches[ i ].fd = -1;
+
+	_epoll = epoll_create1( EPOLL_CLOEXEC );
+	_timer = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+
+	// the timer is told apart from the watches by a NULL pointer
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+
+	if( _epoll < 0 || _timer < 0 || epoll_ctl( _epoll, EPOLL_CTL_ADD, _timer, &ev ) < 0 ) {
+
+		// unusable. service() fails
+		if( _timer >= 0 ) close( _timer );
+		if( _epoll >= 0 ) close( _epoll );
+
+		_timer = -1;
+		_epoll = -1;
+	}
+}
+
+Reactor::~Reactor() {
+
+	for( int i = 0; i < KNOBS_REACTOR_WATCHES; i++ ) {
+
+		if( _watches[ i ].fd >= 0 ) _drop( _watches[ i ] );
+	}
+
+	if( _epoll < 0 ) return;
+
+	close( _timer );
+	close( _epoll );
+}
+
+Reactor& Reactor::operator <<( Panel &panel ) {
+
+	_panels.add( panel );
+	_arm();
+
+	return *this;
+}
+
+Reactor& Reactor::operator <<( Transducer &transducer ) {
+
+	_transducers.add( transducer );
+	_arm();
+
+	return *this;
+}
+
+Reactor::Watch *Reactor::_add( int fd, reactor_callback_t cb, void *ctx ) {
+
+	struct epoll_event ev;
+
+	for( int i = 0; i < KNOBS_REACTOR_WATCHES; i++ ) {
+
+		Watch &watch = _watches[ i ];
+
+		if( watch.fd >= 0 ) continue;
+
+		ev.events = cb ? EPOLLIN : EPOLLOUT;
+		ev.data.ptr = &watch;
+
+		if( epoll_ctl( _epoll, EPOLL_CTL_ADD, fd, &ev ) < 0 ) return NULL;
+
+		watch.fd = fd;
+		watch.cb = cb;
+		watch.ctx = ctx;
+		watch.pin = 0;
+		watch.out = NULL;
+		watch.outCtx = NULL;
+
+		return &watch;
+	}
+
+	return NULL;
+}
+
+Reactor::Watch *Reactor::_find( int fd ) {
+
+	for( int i = 0; i < KNOBS_REACTOR_WATCHES; i++ ) {
+
+		if( _watches[ i ].fd == fd ) return &_watches[ i ];
+	}
+
+	return NULL;
+}
+
+// update epoll after out changed. Drops watches left without callbacks
+void Reactor::_events( Watch &watch ) {
+
+	struct epoll_event ev;
+
+	if( !watch.cb && !watch.out ) {
+		_drop( watch );
+		return;
+	}
+
+	ev.events = ( watch.cb ? EPOLLIN : 0 ) | ( watch.out ? EPOLLOUT : 0 );
+	ev.data.ptr = &watch;
+
+	epoll_ctl( _epoll, EPOLL_CTL_MOD, watch.fd, &ev );
+}
+
+void Reactor::_drop( Watch &watch ) {
+
+	epoll_ctl( _epoll, EPOLL_CTL_DEL, watch.fd, NULL );
+
+	// gpio fds are ours
+	if( watch.cb == _gpio ) close( watch.fd );
+
+	watch.fd = -1;
+}
+
+Reactor& Reactor::watch( int fd, reactor_callback_t cb, void *ctx ) {
+
+	_add( fd, cb, ctx );
+
+	return *this;
+}
+
+Reactor& Reactor::unwatch( int fd ) {
+
+	for( int i = 0; i < KNOBS_REACTOR_WATCHES; i++ ) {
+
+		if( _watches[ i ].fd == fd ) _drop( _watches[ i ] );
+	}
+
+	return *this;
+}
+
+Reactor& Reactor::output( int fd, reactor_callback_t cb, void *ctx ) {
+
+	Watch *watch = _find( fd );
+
+	if( !watch ) watch = _add( fd, NULL, NULL );
+	if( !watch ) return *this;
+
+	watch->out = cb;
+	watch->outCtx = ctx;
+
+	// an output only watch is added with EPOLLOUT already
+	if( watch->cb ) _events( *watch );
+
+	return *this;
+}
+
+bool Reactor::gpio( const char *chip, uint32_t line, pin_t pin ) {
+
+	struct gpioevent_request req;
+	struct gpiohandle_data data;
+	Watch *watch;
+
+	int fd = open( chip, O_RDONLY | O_CLOEXEC );
+
+	if( fd < 0 ) return false;
+
+	memset( &req, 0, sizeof( req ) );
+	req.lineoffset = line;
+	req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+	req.eventflags = GPIOEVENT_REQUEST_BOTH_EDGES;
+	strncpy( req.consumer_label, "knobs", sizeof( req.consumer_label )-1 );
+
+	int ok = ioctl( fd, GPIO_GET_LINEEVENT_IOCTL, &req );
+
+	close( fd );
+
+	if( ok < 0 ) return false;
+
+	// _gpio reads until there are no more events
+	if( fcntl( req.fd, F_SETFL, fcntl( req.fd, F_GETFL ) | O_NONBLOCK ) < 0 ) {
+		close( req.fd );
+		return false;
+	}
+
+	// start with current level
+	if( ioctl( req.fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data ) == 0 )
+			sim().input( pin, data.values[ 0 ] );
+
+	watch = _add( req.fd, _gpio, NULL );
+
+	if( !watch ) {
+		close( req.fd );
+		return false;
+	}
+
+	watch->ctx = watch;
+	watch->pin = pin;
+
+	return true;
+}
+
+bool Reactor::_gpio( int fd, void *ctx ) {
+
+	Watch *watch = (Watch*)ctx;
+	struct gpioevent_data event;
+
+	for( ;; ) {
+
+		ssize_t n = read( fd, &event, sizeof( event ) );
+
+		if( n < 0 && errno == EINTR ) continue;
+
+		// EAGAIN: all read
+		if( n != sizeof( event ) ) return n < 0 && errno == EAGAIN;
+
+		sim().input( watch->pin, event.id == GPIOEVENT_EVENT_RISING_EDGE ? HIGH : LOW );
+	}
+}
+
+Reactor& Reactor::period( knob_time_t time ) {
+
+	_period = time;
+	_arm();
+
+	return *this;
+}
+
+int Reactor::fd() {
+
+	return _epoll;
+}
+
+void Reactor::_arm() {
+
+	struct itimerspec spec;
+	knob_time_t due = KNOB_TIME_NEVER, d;
+	Panel *panel;
+	Transducer *transducer;
+
+	for( Cursor<Panel> it( _panels ); ( panel = it.next() ); ) {
+
+		d = panel->due();
+		if( d < due ) due = d;
+	}
+	for( Cursor<Transducer> it( _transducers ); ( transducer = it.next() ); ) {
+
+		d = transducer->due();
+		if( d < due ) due = d;
+	}
+
+	memset( &spec, 0, sizeof( spec ) );
+
+	if( due != KNOB_TIME_NEVER ) {
+
+		if( due < _period ) due = _period;
+
+		spec.it_value.tv_sec = due / KNOB_SEC( 1 );
+		spec.it_value.tv_nsec = ( due % KNOB_SEC( 1 ) ) * ( 1000000000 / KNOB_SEC( 1 ) );
+	}
+
+	// all zero disarms
+	timerfd_settime( _timer, 0, &spec, NULL );
+}
+
+bool Reactor::service( int timeout ) {
+
+	struct epoll_event events[ _EVENTS ];
+	uint64_t expired;
+	Panel *panel;
+	Transducer *transducer;
+
+	if( _epoll < 0 ) return false;
+
+	int n = epoll_wait( _epoll, events, _EVENTS, timeout );
+
+	if( n < 0 ) return errno == EINTR;
+
+	for( int i = 0; i < n; i++ ) {
+
+		Watch *watch = (Watch*)events[ i ].data.ptr;
+
+		if( watch ) {
+			uint32_t what = events[ i ].events;
+
+			// may be unwatched by a callback before. Errors and hangups
+			// go to both, the calls find out.
+			if( watch->fd >= 0 && watch->cb && what & ( EPOLLIN | EPOLLERR | EPOLLHUP )
+					&& !watch->cb( watch->fd, watch->ctx ) ) _drop( *watch );
+
+			if( watch->fd >= 0 && watch->out && what & ( EPOLLOUT | EPOLLERR | EPOLLHUP )
+					&& !watch->out( watch->fd, watch->outCtx ) ) {
+				watch->out = NULL;
+				_events( *watch );
+			}
+		} else {
+			if( read( _timer, &expired, sizeof( expired ) ) < 0 && errno != EAGAIN ) return false;
+		}
+	}
+
+	for( Cursor<Panel> it( _panels ); ( panel = it.next() ); ) {
+
+		panel->loop();
+	}
+	for( Cursor<Transducer> it( _transducers ); ( transducer = it.next() ); ) {
+
+		transducer->loop();
+	}
+
+	_arm();
+
+	return true;
+}
@@ -0,0 +1,105 @@
+#ifndef KNOBS_HOST_REACTOR_H
+#define KNOBS_HOST_REACTOR_H
+
+/*
+ * Runs Panels and Transducers inside a Linux event loop.
+ *
+ * The Reactor owns an epoll fd which becomes readable when something
+ * needs service: A timerfd armed to the next due() of all Panels and
+ * Transducers or one of the watched fds (e.g. GPIO edge events, or
+ * room for output which would have blocked).
+ * So it can be put into any other event loop and uses no cpu when idle.
+ *
+ * Times are taken from the Host clock which must be the SystemClock.
+ * They are in knob time units. See KNOB_MS
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Knob.h"
+#include "Valve.h"
+
+#ifndef KNOBS_REACTOR_SIZE
+	#define KNOBS_REACTOR_SIZE 8
+#endif
+#ifndef KNOBS_REACTOR_WATCHES
+	#define KNOBS_REACTOR_WATCHES 16
+#endif
+
+namespace Knobs {
+namespace Host {
+
+	// return false to be unwatched. (e.g. end of input)
+	typedef bool (*reactor_callback_t)( int fd, void *ctx );
+
+	class Reactor {
+
+		private:
+			struct Watch {
+				int fd;
+				reactor_callback_t cb;
+				void *ctx;
+				pin_t pin;
+				// while waiting for room to write
+				reactor_callback_t out;
+				void *outCtx;
+			};
+
+			int _epoll;
+			int _timer;
+
+			knob_time_t _period;
+
+			Canister<Panel, KNOBS_REACTOR_SIZE> _panels;
+			Canister<Transducer, KNOBS_REACTOR_SIZE> _transducers;
+
+			Watch _watches[ KNOBS_REACTOR_WATCHES ];
+
+			Watch *_add( int fd, reactor_callback_t cb, void *ctx );
+			Watch *_find( int fd );
+			void _events( Watch &watch );
+			void _drop( Watch &watch );
+			void _arm();
+
+			static bool _gpio( int fd, void *ctx );
+
+		public:
+			Reactor();
+			~Reactor();
+
+			// service Panel/Transducer
+			Reactor& operator <<( Panel &panel );
+			Reactor& operator <<( Transducer &transducer );
+
+			// call cb when fd is readable. Panels/Transducers are looped afterwards.
+			// Dropped when cb returns false.
+			Reactor& watch( int fd, reactor_callback_t cb, void *ctx=NULL );
+			Reactor& unwatch( int fd );
+
+			// call cb when fd is writable again, until it returns false. For
+			// output which would have blocked. fd may be watched for input
+			// as well. Another call replaces cb.
+			Reactor& output( int fd, reactor_callback_t cb, void *ctx=NULL );
+
+			// Feed edges of a GPIO line (/dev/gpiochipN) into the simulated pin.
+			// Knobs using interrupt mode get their edges from here.
+			// Returns false if the line couldn't be requested.
+			bool gpio( const char *chip, uint32_t line, pin_t pin );
+
+			// Interval for devices which want to be polled continuously
+			// (due() == 0). Default is KNOB_MS( 1 ).
+			Reactor& period( knob_time_t time );
+
+			// readable when service is needed. -1 if epoll or timerfd
+			// couldn't be created
+			int fd();
+
+			// wait max. timeout ms (-1: forever, 0: don't wait) and handle
+			// whatever is due. Returns false on error, always if fd() is -1.
+			bool service( int timeout=0 );
+	};
+}
+}
+
+#endif
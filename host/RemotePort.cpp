@@ -0,0 +1,199 @@
+#include "RemotePort.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+RemotePort::RemotePort( Remote &remote, int in, int out )
+		: _remote( remote ), _in( in ), _out( out < 0 ? in : out ), _own( false ),
+		  _reactor( NULL ), _nPending( 0 ), _dropped( 0 ) {
+
+	_remote.output( _send, this );
+}
+
+RemotePort::~RemotePort() {
+
+	if( _own ) close( _in );
+}
+
+bool RemotePort::pty( char *name, size_t size ) {
+
+	struct termios tio;
+
+	int fd = posix_openpt( O_RDWR | O_NOCTTY | O_CLOEXEC );
+
+	if( fd < 0 ) return false;
+
+	if( grantpt( fd ) < 0 || unlockpt( fd ) < 0 || ptsname_r( fd, name, size ) ) {
+		close( fd );
+		return false;
+	}
+
+	// binary frames: no echo, no line editing, no translation
+	if( tcgetattr( fd, &tio ) == 0 ) {
+		cfmakeraw( &tio );
+		tcsetattr( fd, TCSANOW, &tio );
+	}
+
+	fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+
+	if( _own ) close( _in );
+
+	_in = _out = fd;
+	_own = true;
+
+	return true;
+}
+
+void RemotePort::_send( const uint8_t *frame, uint8_t length, void *ctx ) {
+
+	RemotePort *port = (RemotePort*)ctx;
+
+	// behind the ones held back
+	while( length && !port->_nPending ) {
+
+		ssize_t n = write( port->_out, frame, length );
+
+		if( n < 0 ) {
+			if( errno == EINTR ) continue;
+			if( errno == EAGAIN || errno == EWOULDBLOCK ) break;
+			port->_dropped++;
+			return;
+		}
+
+		frame += n;
+		length -= n;
+	}
+
+	if( !length ) return;
+
+	// whole frames only. A part of one would garble the stream
+	if( length > KNOBS_REMOTEPORT_PENDING - port->_nPending ) {
+		port->_dropped++;
+		return;
+	}
+
+	if( !port->_nPending && port->_reactor ) port->_reactor->output( port->_out, _writable, port );
+
+	memcpy( port->_pending + port->_nPending, frame, length );
+	port->_nPending += length;
+}
+
+bool RemotePort::flush() {
+
+	size_t done = 0;
+
+	while( done < _nPending ) {
+
+		ssize_t n = write( _out, _pending + done, _nPending - done );
+
+		if( n < 0 ) {
+			if( errno == EINTR ) continue;
+			if( errno == EAGAIN || errno == EWOULDBLOCK ) break;
+			_nPending = 0;
+			_dropped++;
+			return false;
+		}
+
+		done += n;
+	}
+
+	memmove( _pending, _pending + done, _nPending - done );
+	_nPending -= done;
+
+	return true;
+}
+
+bool RemotePort::_writable( int fd, void *ctx ) {
+
+	RemotePort *port = (RemotePort*)ctx;
+
+	// keep waiting while some are left
+	return port->flush() && port->_nPending;
+}
+
+size_t RemotePort::pending() {
+
+	return _nPending;
+}
+
+uint32_t RemotePort::dropped() {
+
+	return _dropped;
+}
+
+bool RemotePort::service() {
+
+	uint8_t *to;
+	int length;
+	ssize_t n;
+
+	flush();
+
+	for( ;; ) {
+
+		// a frame is always smaller than the buffer, so there is
+		// room after poll
+		to = _remote.room( length );
+
+		if( !to ) {
+			if( !_remote.poll() ) return true;
+			continue;
+		}
+
+		n = read( _in, to, length );
+
+		if( n > 0 ) {
+			_remote.commit( n );
+			if( n == length ) continue;
+			_remote.poll();
+			return true;
+		}
+
+		_remote.poll();
+
+		if( n == 0 ) return false;
+		if( errno == EINTR ) continue;
+
+		// EIO: pty client went away
+		return errno == EAGAIN || errno == EWOULDBLOCK;
+	}
+}
+
+bool RemotePort::_readable( int fd, void *ctx ) {
+
+	RemotePort *port = (RemotePort*)ctx;
+
+	if( port->service() ) return true;
+
+	// the reactor drops the watch. Input ends for good
+	if( port->_own ) {
+		close( port->_in );
+		port->_in = port->_out = -1;
+		port->_own = false;
+		port->_nPending = 0;
+	}
+
+	return false;
+}
+
+RemotePort& RemotePort::watch( Reactor &reactor ) {
+
+	_reactor = &reactor;
+
+	reactor.watch( _in, _readable, this );
+	if( _nPending ) reactor.output( _out, _writable, this );
+
+	return *this;
+}
+
+int RemotePort::fd() {
+
+	return _in;
+}
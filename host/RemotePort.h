@@ -0,0 +1,77 @@
+#ifndef KNOBS_HOST_REMOTEPORT_H
+#define KNOBS_HOST_REMOTEPORT_H
+
+/*
+ * Connects a Remote to file descriptors: A pipe, socket, serial device
+ * or a pseudo terminal opened here for testing.
+ *
+ * Received bytes are read straight into the Remote's buffer and
+ * executed. Replies are written to the output fd. Replies which would
+ * block are held back and written when the fd has room again.
+ */
+
+#include <stddef.h>
+
+#include "Remote.h"
+#include "Reactor.h"
+
+// bytes of replies held back while the output fd is full
+#ifndef KNOBS_REMOTEPORT_PENDING
+	#define KNOBS_REMOTEPORT_PENDING 256
+#endif
+
+namespace Knobs {
+namespace Host {
+
+	class RemotePort {
+
+		private:
+			Remote &_remote;
+			int _in;
+			int _out;
+			bool _own;
+
+			Reactor *_reactor;
+
+			uint8_t _pending[ KNOBS_REMOTEPORT_PENDING ];
+			size_t _nPending;
+			uint32_t _dropped;
+
+			static void _send( const uint8_t *frame, uint8_t length, void *ctx );
+			static bool _readable( int fd, void *ctx );
+			static bool _writable( int fd, void *ctx );
+
+		public:
+			// in/out may be the same fd. Set later with pty().
+			RemotePort( Remote &remote, int in=-1, int out=-1 );
+			~RemotePort();
+
+			// open a pseudo terminal in raw mode and use its master side.
+			// name gets the path of the side to give the client.
+			bool pty( char *name, size_t size );
+
+			// read and execute whatever arrived. Returns false on end of
+			// input or error.
+			bool service();
+
+			// write replies held back. Returns false on error, they are
+			// dropped then. Done by service() and the reactor.
+			bool flush();
+
+			// bytes held back
+			size_t pending();
+			// replies dropped, no room to hold them back or error
+			uint32_t dropped();
+
+			// let reactor call service when input arrives and flush when
+			// output has room. Unwatched at end of input or on error, the
+			// pty is closed then.
+			RemotePort& watch( Reactor &reactor );
+
+			// -1 if closed
+			int fd();
+	};
+}
+}
+
+#endif
@@ -0,0 +1,296 @@
+#include "Replay.h"
+
+#include "Arduino.h"
+#include "HandlerNames.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+Replay *Replay::_current = NULL;
+
+static uint64_t _cpuNow() {
+
+	struct timespec ts;
+
+	clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+Replay::Replay() {
+
+	_samples = NULL;
+	_count = 0;
+	_size = 0;
+	_pos = 0;
+
+	_period = 1000;
+	_out = NULL;
+
+	_ticks = 0;
+	_cpu = 0;
+	_cpuMax = 0;
+
+	_current = this;
+
+	_oldHal = &hal();
+	_oldClock = &clock();
+
+	use( _clock );
+	use( sim() );
+	sim().onOutput( _output );
+}
+
+Replay::~Replay() {
+
+	free( _samples );
+
+	if( _current == this ) {
+		_current = NULL;
+		sim().onOutput( NULL );
+	}
+
+	use( *_oldHal );
+	use( *_oldClock );
+}
+
+Replay& Replay::operator <<( Panel &panel ) {
+
+	_panels.add( panel );
+
+	return *this;
+}
+
+Replay& Replay::operator <<( Transducer &transducer ) {
+
+	_transducers.add( transducer );
+
+	return *this;
+}
+
+bool Replay::add( uint64_t time, pin_t pin, value_t value ) {
+
+	if( _count && time < _samples[ _count-1 ].time ) return false;
+
+	if( _count == _size ) {
+
+		long size = _size ? _size * 2 : 1024;
+		Sample *samples = (Sample*)realloc( _samples, size * sizeof( Sample ) );
+
+		if( !samples ) return false;
+
+		_samples = samples;
+		_size = size;
+	}
+
+	Sample &sample = _samples[ _count++ ];
+
+	sample.time = time;
+	sample.pin = pin;
+	sample.value = value;
+
+	return true;
+}
+
+long Replay::load( const char *path ) {
+
+	char line[ 128 ];
+	unsigned long long time;
+	unsigned int pin;
+	unsigned long value;
+	long count = 0;
+	char c;
+
+	FILE *in = fopen( path, "r" );
+
+	if( !in ) return -1;
+
+	while( fgets( line, sizeof( line ), in ) ) {
+
+		if( sscanf( line, " %c", &c ) < 1 || c == '#' ) continue;
+
+		if( sscanf( line, "%llu %u %lu", &time, &pin, &value ) != 3
+				|| !add( time, pin, value ) ) {
+			count = -1;
+			break;
+		}
+
+		count++;
+	}
+
+	fclose( in );
+
+	return count;
+}
+
+Replay& Replay::output( FILE *out ) {
+
+	_out = out;
+
+	return *this;
+}
+
+Replay& Replay::period( uint64_t us ) {
+
+	_period = us ? us : 1;
+
+	return *this;
+}
+
+void Replay::_output( pin_t pin, value_t value, knob_time_t time ) {
+
+	if( !_current || !_current->_out ) return;
+
+	fprintf( _current->_out, "%llu out %d %d\n",
+			(unsigned long long)_current->_clock.micros(), pin, (int)value );
+}
+
+bool Replay::log( Device &dev, Handler &handler,
+		knob_value_t newState, knob_value_t oldState, knob_time_t count ) {
+
+	if( !_current || !_current->_out ) return true;
+
+	fprintf( _current->_out, "%llu %s %s %ld %ld %lld\n",
+			(unsigned long long)_current->_clock.micros(), dev.name(), handlerName( handler.type ),
+			(long)newState, (long)oldState, (long long)count );
+
+	return true;
+}
+
+void Replay::_state( Transducer &transducer, Valve &valve, knob_value_t val ) {
+
+	fprintf( _current->_out, "%llu end %s %d\n",
+			(unsigned long long)_current->_clock.micros(), valve.name(), valve.active() );
+}
+
+// time in us until the next loop is needed. 0: none needed
+uint64_t Replay::_due() {
+
+	knob_time_t due = KNOB_TIME_NEVER, d;
+	Panel *panel;
+	Transducer *transducer;
+
+	for( Cursor<Panel> it( _panels ); ( panel = it.next() ); ) {
+
+		d = panel->due();
+		if( d < due ) due = d;
+	}
+	for( Cursor<Transducer> it( _transducers ); ( transducer = it.next() ); ) {
+
+		d = transducer->due();
+		if( d < due ) due = d;
+	}
+
+	if( due == KNOB_TIME_NEVER ) return 0;
+
+	uint64_t us = due * 1000 / KNOB_MS( 1 );
+
+	return us < _period ? _period : us;
+}
+
+void Replay::_tick() {
+
+	Panel *panel;
+	Transducer *transducer;
+
+	uint64_t start = _cpuNow();
+
+	for( Cursor<Panel> it( _panels ); ( panel = it.next() ); ) {
+
+		panel->loop();
+	}
+	for( Cursor<Transducer> it( _transducers ); ( transducer = it.next() ); ) {
+
+		transducer->loop();
+	}
+
+	uint64_t cpu = _cpuNow() - start;
+
+	_ticks++;
+	_cpu += cpu;
+	if( cpu > _cpuMax ) _cpuMax = cpu;
+}
+
+uint32_t Replay::runUntil( uint64_t time ) {
+
+	uint32_t ticks = _ticks;
+	uint64_t now, next, due;
+
+	_current = this;
+
+	// first look at the inputs as they are
+	if( !_ticks ) _tick();
+
+	while( ( now = _clock.micros() ) < time ) {
+
+		next = time;
+
+		due = _due();
+		if( due && now + due < next ) next = now + due;
+
+		if( _pos < _count && _samples[ _pos ].time < next ) next = _samples[ _pos ].time;
+		if( next < now ) next = now;
+
+		_clock.set( next );
+
+		for( ; _pos < _count && _samples[ _pos ].time <= next; _pos++ ) {
+
+			sim().input( _samples[ _pos ].pin, _samples[ _pos ].value );
+		}
+
+		_tick();
+	}
+
+	return _ticks - ticks;
+}
+
+uint32_t Replay::run( uint64_t tail ) {
+
+	Transducer *transducer;
+
+	uint64_t end = ( _count ? _samples[ _count-1 ].time : _clock.micros() ) + tail;
+
+	uint32_t ticks = runUntil( end );
+
+	if( _out ) {
+
+		for( Cursor<Transducer> it( _transducers ); ( transducer = it.next() ); ) {
+
+			transducer->each( _state );
+		}
+	}
+
+	return ticks;
+}
+
+uint64_t Replay::now() {
+
+	return _clock.micros();
+}
+
+uint32_t Replay::ticks() {
+
+	return _ticks;
+}
+
+uint64_t Replay::cpu() {
+
+	return _cpu;
+}
+
+uint64_t Replay::cpuMax() {
+
+	return _cpuMax;
+}
+
+Replay& Replay::report( FILE *to ) {
+
+	fprintf( to, "replayed %.3f s in %u loops, cpu %.3f ms total, %.0f ns/loop, %llu ns max\n",
+			_clock.micros() / 1e6, _ticks, _cpu / 1e6,
+			_ticks ? (double)_cpu / _ticks : 0.0, (unsigned long long)_cpuMax );
+
+	return *this;
+}
@@ -0,0 +1,125 @@
+#ifndef KNOBS_HOST_REPLAY_H
+#define KNOBS_HOST_REPLAY_H
+
+/*
+ * Replays recorded inputs through Panels and Transducers as fast as
+ * the cpu can.
+ *
+ * Samples (pin changes and analog values) are applied to the SimHal
+ * under a VirtualClock. Between samples the clock jumps to the next
+ * due() of the Panels and Transducers, so hours of recording only
+ * take as many loops as something actually happens.
+ *
+ * Valve outputs and handler calls (with Replay::log as callback) are
+ * written as text lines for diffing:
+ *
+ *     <us> out <pin> <level>
+ *     <us> <device> <handler> <newState> <oldState> <count>
+ *     <us> end <valve> <state>      (after run)
+ *
+ * The cpu time of every loop is measured.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "Hal.h"
+#include "Knob.h"
+#include "Valve.h"
+
+#ifndef KNOBS_REPLAY_SIZE
+	#define KNOBS_REPLAY_SIZE 8
+#endif
+
+namespace Knobs {
+namespace Host {
+
+	// One recorded input. time in us.
+	struct Sample {
+		uint64_t time;
+		pin_t pin;
+		value_t value;
+	};
+
+	class Replay {
+
+		private:
+			Sample *_samples;
+			long _count;
+			long _size;
+			long _pos;
+
+			VirtualClock _clock;
+			// backends in use before
+			Hal *_oldHal;
+			Clock *_oldClock;
+			uint64_t _period;
+
+			Canister<Panel, KNOBS_REPLAY_SIZE> _panels;
+			Canister<Transducer, KNOBS_REPLAY_SIZE> _transducers;
+
+			FILE *_out;
+
+			// loops and their cpu time in ns
+			uint32_t _ticks;
+			uint64_t _cpu;
+			uint64_t _cpuMax;
+
+			// the one callbacks go to
+			static Replay *_current;
+
+			static void _output( pin_t pin, value_t value, knob_time_t time );
+			static void _state( Transducer &transducer, Valve &valve, knob_value_t val );
+
+			uint64_t _due();
+			void _tick();
+
+		public:
+			// takes over Host's clock and the SimHal's output callback.
+			// The backends used before are restored when destroyed.
+			Replay();
+			~Replay();
+
+			Replay& operator <<( Panel &panel );
+			Replay& operator <<( Transducer &transducer );
+
+			// add sample. Returns false if out of time order or out of memory.
+			bool add( uint64_t time, pin_t pin, value_t value );
+
+			// add samples from text file with lines "<us> <pin> <value>".
+			// '#' starts a comment. Returns amount of samples or -1 on error.
+			long load( const char *path );
+
+			// where outputs and handler calls are written. Default: none
+			Replay& output( FILE *out );
+
+			// interval for devices which want to be polled continuously
+			// (due() == 0) in us. Default 1000
+			Replay& period( uint64_t us );
+
+			// replay all samples and go on for tail us.
+			// Writes the Valves' states at the end. Returns loops run.
+			uint32_t run( uint64_t tail=0 );
+			// replay up to time us. Returns loops run.
+			uint32_t runUntil( uint64_t time );
+
+			// use as handler callback to get calls written to output
+			static bool log( Device &dev, Handler &handler,
+					knob_value_t newState, knob_value_t oldState, knob_time_t count );
+
+			// current time in us
+			uint64_t now();
+
+			// loops run so far
+			uint32_t ticks();
+			// their total and max. cpu time in ns
+			uint64_t cpu();
+			uint64_t cpuMax();
+
+			// print statistics
+			Replay& report( FILE *to );
+	};
+}
+}
+
+#endif
@@ -0,0 +1,516 @@
+/*
+ * Microbenchmarks of handlers, modifiers and device loops.
+ *
+ *   knobs_bench [--filter text] [--time ms] [--repeat n]
+ *
+ * Runs every benchmark whose name contains text once to warm up and then
+ * n times (default 5) for at least ms (default 100) each. Prints the
+ * results as JSON to stdout:
+ *
+ *   { "suite": "knobs", "results": [
+ *     { "name": "...", "params": { ... }, "iterations": n,
+ *       "repetitions": r, "ns_per_op": median, "ns_min": x, "ns_max": y,
+ *       "allocs_per_op": z }, ... ] }
+ *
+ * Inputs come from the SimHal under a VirtualClock, so results only
+ * depend on the library's code. The clock moves on 1 ms with every loop,
+ * across warmup and repetitions, as it would in a sketch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+
+#include "Arduino.h"
+#include "Hal.h"
+#include "Knobs.h"
+#include "ACS712.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+#define _MAX_DEVICES 64
+#define _MAX_CHAIN 16
+#define _MAX_VALVES 32
+#define _STEPS 256
+#define _MAX_REPEAT 32
+
+
+/*****************************************************************************
+*
+*   A L L O C A T I O N S
+*
+*****************************************************************************/
+
+static volatile unsigned long _allocs = 0;
+
+#ifdef __GLIBC__
+extern "C" {
+	void *__libc_malloc( size_t size );
+	void *__libc_calloc( size_t n, size_t size );
+	void *__libc_realloc( void *p, size_t size );
+
+	// C allocations, too
+	void *malloc( size_t size ) {
+		_allocs++;
+		return __libc_malloc( size );
+	}
+	void *calloc( size_t n, size_t size ) {
+		_allocs++;
+		return __libc_calloc( n, size );
+	}
+	void *realloc( void *p, size_t size ) {
+		_allocs++;
+		return __libc_realloc( p, size );
+	}
+}
+	// not counted twice by malloc
+	#define _MALLOC( size ) __libc_malloc( size )
+#else
+	#define _MALLOC( size ) malloc( size )
+#endif
+
+void *operator new( size_t size ) {
+
+	_allocs++;
+
+	void *p = _MALLOC( size ? size : 1 );
+
+	if( !p ) throw std::bad_alloc();
+
+	return p;
+}
+void *operator new[]( size_t size ) {
+	return operator new( size );
+}
+void operator delete( void *p ) noexcept {
+	free( p );
+}
+void operator delete[]( void *p ) noexcept {
+	free( p );
+}
+
+
+/*****************************************************************************
+*
+*   R U N N E R
+*
+*****************************************************************************/
+
+static const char *_filter = NULL;
+static uint64_t _minTime = 100000000;
+static int _repeat = 5;
+static bool _first = true;
+
+static volatile knob_value_t _sink;
+
+static uint64_t _nanos() {
+
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// run op( i ) for i in 0..n
+template <typename F>
+static uint64_t _time( F &op, uint64_t n ) {
+
+	uint64_t start = _nanos();
+
+	for( uint64_t i = 0; i < n; i++ ) op( i );
+
+	return _nanos() - start;
+}
+
+// params: JSON members, e.g. "\"chain\": 4"
+template <typename F>
+static void bench( const char *name, const char *params, F op ) {
+
+	uint64_t n = 1, ns, runs[ _MAX_REPEAT ];
+	unsigned long allocs;
+	int r, i;
+
+	if( _filter && !strstr( name, _filter ) ) return;
+
+	// find iterations lasting _minTime
+	for( ;; ) {
+
+		ns = _time( op, n );
+
+		if( ns >= _minTime || n >= ( 1ull << 32 ) ) break;
+
+		uint64_t grow = ns ? _minTime * 12 / 10 / ns : 100;
+		n *= grow < 2 ? 2 : grow > 100 ? 100 : grow;
+	}
+
+	// warm up with the final count
+	_time( op, n );
+
+	allocs = _allocs;
+
+	// sorted
+	for( r = 0; r < _repeat; r++ ) {
+
+		ns = _time( op, n );
+
+		for( i = r; i > 0 && runs[ i-1 ] > ns; i-- ) runs[ i ] = runs[ i-1 ];
+		runs[ i ] = ns;
+	}
+
+	allocs = _allocs - allocs;
+
+	printf( "%s\n    { \"name\": \"%s\", \"params\": { %s }, \"iterations\": %llu, "
+			"\"repetitions\": %d, \"ns_per_op\": %.3f, \"ns_min\": %.3f, \"ns_max\": %.3f, "
+			"\"allocs_per_op\": %.3f }",
+			_first ? "" : ",", name, params, (unsigned long long)n, _repeat,
+			(double)runs[ _repeat / 2 ] / n, (double)runs[ 0 ] / n,
+			(double)runs[ _repeat - 1 ] / n, (double)allocs / n / _repeat );
+
+	_first = false;
+
+	fflush( stdout );
+}
+
+
+/*****************************************************************************
+*
+*   I N P U T S
+*
+*****************************************************************************/
+
+static VirtualClock _clock;
+
+// time of the next loop
+static inline knob_time_t _tick() {
+
+	_clock.advance( 1 );
+
+	return uptime();
+}
+
+// one activation as a device would pass it
+struct Step {
+	knob_value_t newState;
+	knob_value_t oldState;
+	knob_time_t time;
+};
+
+// binary: a loop every ms with presses of different length and gaps
+static Step _binary[ _STEPS ];
+// analog: triangle with noise
+static Step _analog[ _STEPS ];
+static knob_value_t _noise[ _STEPS ];
+
+static void _inputs() {
+
+	static const int lengths[] = { 40, 120, 30, 600, 80, 1500, 20, 200 };
+
+	knob_value_t state = 0, old = 0, level;
+	knob_time_t since = 0;
+	int phase = 0;
+
+	srand( 1 );
+
+	for( int i = 0; i < _STEPS; i++ ) {
+
+		if( since >= KNOB_MS( lengths[ phase ] ) / 8 ) {
+			state = !state;
+			phase = ( phase + 1 ) % 8;
+			since = 0;
+		}
+
+		_binary[ i ].newState = state;
+		_binary[ i ].oldState = old;
+		_binary[ i ].time = since;
+
+		since = state == old ? since + KNOB_MS( 1 ) : 0;
+		old = state;
+
+		_noise[ i ] = rand() % 1024;
+	}
+
+	old = 0;
+
+	for( int i = 0; i < _STEPS; i++ ) {
+
+		level = ( i < _STEPS/2 ? i : _STEPS-i ) * 1024 / ( _STEPS/2 ) + _noise[ i ] % 32;
+
+		_analog[ i ].newState = level;
+		_analog[ i ].oldState = old;
+		_analog[ i ].time = KNOB_MS( i % 16 );
+
+		old = level;
+	}
+}
+
+static bool _nop( knob_value_t value ) {
+	return true;
+}
+
+// handlers of all kinds, as a sketch would chain them
+#define _MIXED 8
+
+struct Mixed {
+
+	Push push;
+	Release release;
+	Click click;
+	DoubleClick doubleClick;
+	Hold hold;
+	Toggle toggle;
+	MultiClick multiClick;
+	Transport transport;
+
+	Mixed() : push( _nop ), release( _nop ), click( _nop ), doubleClick( _nop ),
+			hold( _nop, KNOB_MS( 100 ) ), toggle( _nop ), multiClick( _nop ),
+			transport( _nop, KNOB_MS( 50 ) ) {}
+
+	Handler &operator[]( int i ) {
+
+		Handler *all[ _MIXED ] = { &push, &release, &click, &doubleClick,
+				&hold, &toggle, &multiClick, &transport };
+
+		return *all[ i % _MIXED ];
+	}
+};
+
+// Lever which lets the benchmark set its time
+class BenchLever : public Lever {
+
+	public:
+		BenchLever() : Lever( "lever", 1, 0, 1023 ) {}
+
+		void tick( knob_time_t now ) {
+			_sampleTime = now;
+		}
+};
+
+
+/*****************************************************************************
+*
+*   B E N C H M A R K S
+*
+*****************************************************************************/
+
+static void _handler( const char *name, Handler &handler, Step *steps ) {
+
+	Knob device( "device", 2 );
+
+	bench( name, "", [&]( uint64_t i ) {
+		Step &step = steps[ i % _STEPS ];
+		_sink = handler.handle( device, step.newState, step.oldState, step.time );
+	} );
+}
+
+static void _handlers() {
+
+	Push push( _nop );
+	Click click( _nop );
+	DoubleClick doubleClick( _nop );
+	MultiClick multiClick( _nop );
+	Hold hold( _nop, KNOB_MS( 100 ) );
+	Transport transport( _nop, KNOB_MS( 50 ) );
+	Over over( _nop, 512 );
+	Under under( _nop, 512 );
+	Hysteresis hysteresis( _nop, 400, 600 );
+
+	_handler( "handler/Push", push, _binary );
+	_handler( "handler/Click", click, _binary );
+	_handler( "handler/DoubleClick", doubleClick, _binary );
+	_handler( "handler/MultiClick", multiClick, _binary );
+	_handler( "handler/Hold", hold, _binary );
+	_handler( "handler/Transport", transport, _binary );
+	_handler( "handler/Over", over, _analog );
+	_handler( "handler/Under", under, _analog );
+	_handler( "handler/Hysteresis", hysteresis, _analog );
+}
+
+static void _modifier( const char *name, LeverModifier &modifier ) {
+
+	BenchLever lever;
+
+	bench( name, "", [&]( uint64_t i ) {
+		knob_value_t value = _noise[ i % _STEPS ];
+		lever.tick( _tick() );
+		_sink = modifier.modify( lever, &value ) ? value : 0;
+	} );
+}
+
+static void _modifiers() {
+
+	Transpose transpose( 0, 100 );
+	Average average( 16 );
+	AverageTime averageTime( KNOB_MS( 16 ) );
+	RunningAverage runningAverage( 16 );
+	Deviation deviation( KNOB_MS( 16 ) );
+	RunningDeviation runningDeviation( 16 );
+
+	_modifier( "modifier/Transpose", transpose );
+	_modifier( "modifier/Average", average );
+	_modifier( "modifier/AverageTime", averageTime );
+	_modifier( "modifier/RunningAverage", runningAverage );
+	_modifier( "modifier/Deviation", deviation );
+	_modifier( "modifier/RunningDeviation", runningDeviation );
+}
+
+// Knob with chain mixed handlers. Its pin follows _binary
+static void _knob( int chain ) {
+
+	char params[ 32 ];
+	Handler *storage[ _MAX_CHAIN ];
+	Mixed mixed[ _MAX_CHAIN / _MIXED ];
+
+	Knob knob( "knob", 3 );
+
+	knob.handlers( storage, _MAX_CHAIN );
+	for( int i = 0; i < chain; i++ ) knob.on( mixed[ i / _MIXED ][ i ] );
+
+	snprintf( params, sizeof( params ), "\"chain\": %d", chain );
+
+	bench( "loop/Knob", params, [&]( uint64_t i ) {
+		sim().input( 3, _binary[ i % _STEPS ].newState );
+		knob.loop( _tick() );
+	} );
+}
+
+// Panel of devices Knobs with chain mixed handlers each. One pin changes.
+static void _panel( int devices, int chain ) {
+
+	char params[ 48 ];
+	Device *storage[ _MAX_DEVICES ];
+	Handler *chains[ _MAX_DEVICES ][ _MAX_CHAIN ];
+	Crate<Knob, _MAX_DEVICES> knobs;
+	static Mixed mixed[ _MAX_DEVICES ];
+
+	Panel panel( "panel" );
+	panel.devices( storage, _MAX_DEVICES );
+
+	for( int d = 0; d < devices; d++ ) {
+
+		Knob *knob = knobs.make( "knob", 8 + d % 48 );
+
+		knob->handlers( chains[ d ], _MAX_CHAIN );
+
+		for( int i = 0; i < chain && i < _MIXED; i++ ) knob->on( mixed[ d ][ i ] );
+
+		panel << *knob;
+	}
+
+	snprintf( params, sizeof( params ), "\"devices\": %d, \"chain\": %d", devices, chain );
+
+	bench( "loop/Panel", params, [&]( uint64_t i ) {
+		sim().input( 8, _binary[ i % _STEPS ].newState );
+		panel.loop( _tick() );
+	} );
+}
+
+static void _lever( int modifiers ) {
+
+	char params[ 32 ];
+	Lever lever( "lever", 4, 0, 1023 );
+	Transpose transpose( 0, 100 );
+	RunningAverage average( 16 );
+	Over over( _nop, 50 );
+
+	if( modifiers > 0 ) lever.modify( average );
+	if( modifiers > 1 ) lever.modify( transpose );
+	lever.on( over );
+
+	snprintf( params, sizeof( params ), "\"modifiers\": %d", modifiers );
+
+	bench( "loop/Lever", params, [&]( uint64_t i ) {
+		sim().input( 4, _analog[ i % _STEPS ].newState );
+		lever.loop( _tick() );
+	} );
+}
+
+static void _acs712() {
+
+	ACS712 acs( "acs712", 5, x05B, 5000, 16 );
+	Over over( _nop, 1000 );
+
+	acs.on( over );
+
+	bench( "loop/ACS712", "", [&]( uint64_t i ) {
+		sim().input( 5, 512 + _noise[ i % _STEPS ] / 8 );
+		acs.loop( _tick() );
+	} );
+}
+
+static void _transducer( int valves ) {
+
+	char params[ 32 ];
+	Valve *storage[ _MAX_VALVES ];
+	Crate<Valve, _MAX_VALVES> list;
+
+	Transducer transducer( "transducer" );
+	transducer.valves( storage, _MAX_VALVES );
+
+	for( int v = 0; v < valves; v++ ) transducer << *list.make( "valve", 24 + v );
+
+	transducer.begin();
+
+	snprintf( params, sizeof( params ), "\"valves\": %d", valves );
+
+	bench( "Transducer/activeMask", params, [&]( uint64_t i ) {
+		transducer.activeMask( (uint32_t)_noise[ i % _STEPS ] * 0x9E3779B1u );
+	} );
+}
+
+int main( int argc, char **argv ) {
+
+	for( int i = 1; i < argc; i++ ) {
+
+		if( !strcmp( argv[ i ], "--filter" ) && i+1 < argc ) {
+			_filter = argv[ ++i ];
+		} else if( !strcmp( argv[ i ], "--time" ) && i+1 < argc ) {
+			_minTime = strtoull( argv[ ++i ], NULL, 10 ) * 1000000;
+		} else if( !strcmp( argv[ i ], "--repeat" ) && i+1 < argc ) {
+			_repeat = atoi( argv[ ++i ] );
+			_repeat = _repeat < 1 ? 1 : _repeat > _MAX_REPEAT ? _MAX_REPEAT : _repeat;
+		} else {
+			fprintf( stderr, "usage: %s [--filter text] [--time ms] [--repeat n]\n", argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	use( _clock );
+	use( sim() );
+
+	_inputs();
+
+	printf( "{ \"suite\": \"knobs\", \"time_unit\": \"%s\", \"results\": [",
+			KNOB_MS( 1 ) == 1 ? "ms" : "us" );
+
+	_handlers();
+	_modifiers();
+
+	_knob( 1 );
+	_knob( 4 );
+	_knob( 8 );
+	_knob( 16 );
+
+	_panel( 1, 1 );
+	_panel( 8, 1 );
+	_panel( 8, 4 );
+	_panel( 32, 1 );
+	_panel( 32, 4 );
+	_panel( 64, 4 );
+
+	_lever( 0 );
+	_lever( 2 );
+	_acs712();
+
+	_transducer( 4 );
+	_transducer( 8 );
+	_transducer( 20 );
+	_transducer( 32 );
+
+	printf( "\n] }\n" );
+
+	return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * Decodes a dump of Knobs::Trace (see Trace.h) into text.
+ *
+ *   knobs_trace [dump]
+ *
+ * Reads stdin without file. Prints one line per record:
+ * time since the first record, name and what happened.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Trace.h"
+#include "HandlerNames.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+static bool readAll( FILE *in, void *to, size_t length ) {
+
+	return fread( to, 1, length, in ) == length;
+}
+
+static uint32_t le( const uint8_t *p, int bytes ) {
+
+	uint32_t v = 0;
+
+	while( bytes-- ) v = v << 8 | p[ bytes ];
+
+	return v;
+}
+
+int main( int argc, char **argv ) {
+
+	FILE *in = stdin;
+	uint8_t header[ 13 ], head[ 2 ];
+	char names[ TRACE_NO_ID+1 ][ 256 ];
+	TraceRecord record;
+
+	if( argc > 1 && !( in = fopen( argv[ 1 ], "rb" ) ) ) {
+		perror( argv[ 1 ] );
+		return 1;
+	}
+
+	if( !readAll( in, header, sizeof( header ) ) || memcmp( header, TRACE_MAGIC, 4 ) ) {
+		fprintf( stderr, "not a trace dump\n" );
+		return 1;
+	}
+
+	if( header[ 4 ] != TRACE_VERSION ) {
+		fprintf( stderr, "trace version %d not supported\n", header[ 4 ] );
+		return 1;
+	}
+
+	const char *unit = header[ 5 ] ? "us" : "ms";
+	int nNames = header[ 6 ];
+	uint32_t records = le( header + 7, 2 ),
+	         lost = le( header + 9, 4 );
+
+	for( int i = 0; i <= TRACE_NO_ID; i++ ) snprintf( names[ i ], sizeof( names[ i ] ), "#%d", i );
+
+	for( int i = 0; i < nNames; i++ ) {
+
+		if( !readAll( in, head, 2 ) || !readAll( in, names[ head[ 0 ] ], head[ 1 ] ) ) {
+			fprintf( stderr, "truncated names\n" );
+			return 1;
+		}
+		names[ head[ 0 ] ][ head[ 1 ] ] = 0;
+	}
+
+	printf( "# %u records, %u lost, time in %s\n", records, lost, unit );
+
+	uint64_t time = 0;
+
+	for( uint32_t i = 0; i < records; i++ ) {
+
+		if( !readAll( in, &record, sizeof( record ) ) ) {
+			fprintf( stderr, "truncated records\n" );
+			return 1;
+		}
+
+		// time before the first record is unknown
+		if( record.kind == TRACE_TIME ) {
+			if( i ) time += (uint32_t)( (uint16_t)record.newValue << 16 | (uint16_t)record.oldValue );
+			continue;
+		}
+		if( i ) time += record.delta;
+
+		printf( "%12llu  %-16s ", (unsigned long long)time, names[ record.id ] );
+
+		switch( record.kind ) {
+
+			case TRACE_ACTIVATE:
+				printf( "activate %d -> %d\n", record.oldValue, record.newValue );
+				break;
+			case TRACE_FIRE:
+				printf( "%s (%d)\n", handlerName( record.oldValue ), record.newValue );
+				break;
+			case TRACE_VALVE:
+				printf( "%s\n", record.newValue ? "on" : "off" );
+				break;
+			default:
+				printf( "kind %d %d %d\n", record.kind, record.newValue, record.oldValue );
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,131 @@
+#ifndef KNOBS_HOST_CHECK_H
+#define KNOBS_HOST_CHECK_H
+
+/*
+ * Minimal checks for the host tests.
+ *
+ * Every test is one program. A failed check is printed and the test
+ * goes on. main() returns checkResult() so ctest sees the failure.
+ *
+ * Handler callbacks can be recorded with record() and are found
+ * in calls[] with the time they were made.
+ */
+
+#include <stdio.h>
+
+#include "Hal.h"
+#include "Knob.h"
+
+namespace Knobs {
+namespace Host {
+
+	static int _failures = 0;
+
+	static inline bool check( bool ok, const char *what, const char *file, int line ) {
+
+		if( !ok ) {
+			fprintf( stderr, "%s:%d: check failed: %s\n", file, line, what );
+			_failures++;
+		}
+
+		return ok;
+	}
+
+	static inline bool checkEqual( long long is, long long want,
+			const char *what, const char *file, int line ) {
+
+		if( is != want ) {
+			fprintf( stderr, "%s:%d: check failed: %s is %lld, want %lld\n",
+					file, line, what, is, want );
+			_failures++;
+		}
+
+		return is == want;
+	}
+
+	static inline int checkResult() {
+
+		if( _failures ) fprintf( stderr, "%d check(s) failed\n", _failures );
+
+		return _failures ? 1 : 0;
+	}
+
+	#define CHECK( cond ) \
+		Knobs::Host::check( (cond), #cond, __FILE__, __LINE__ )
+	#define CHECK_EQ( is, want ) \
+		Knobs::Host::checkEqual( (long long)(is), (long long)(want), #is, __FILE__, __LINE__ )
+
+	// One recorded handler callback
+	struct Call {
+		HandlerType type;
+		knob_value_t newState;
+		knob_value_t oldState;
+		knob_time_t count;
+		// Device::now() when called
+		knob_time_t time;
+	};
+
+	#define CHECK_CALLS 64
+
+	static Call calls[ CHECK_CALLS ];
+	static int nCalls = 0;
+
+	// use as handler callback
+	static inline bool record( Device &dev, Handler &handler,
+			knob_value_t newState, knob_value_t oldState, knob_time_t count ) {
+
+		if( nCalls < CHECK_CALLS ) {
+			Call &call = calls[ nCalls ];
+			call.type = handler.type;
+			call.newState = newState;
+			call.oldState = oldState;
+			call.count = count;
+			call.time = dev.now();
+		}
+		nCalls++;
+
+		return true;
+	}
+
+	// amount of recorded calls of type
+	static inline int callsOf( HandlerType type ) {
+
+		int n = 0;
+
+		for( int i = 0; i < nCalls && i < CHECK_CALLS; i++ )
+			if( calls[ i ].type == type ) n++;
+
+		return n;
+	}
+
+	// first recorded call of type. NULL if none
+	static inline Call *firstOf( HandlerType type ) {
+
+		for( int i = 0; i < nCalls && i < CHECK_CALLS; i++ )
+			if( calls[ i ].type == type ) return &calls[ i ];
+
+		return NULL;
+	}
+
+	static inline void forget() {
+		nCalls = 0;
+	}
+
+	// let time (knob time units, see KNOB_MS) pass without looping
+	static inline void pass( VirtualClock &clock, knob_time_t time ) {
+		clock.advanceMicros( time * 1000 / KNOB_MS( 1 ) );
+	}
+
+	// loop every ms for time (knob time units)
+	template <typename T>
+	void runFor( T &looped, VirtualClock &clock, knob_time_t time ) {
+
+		for( ; time > 0; time -= KNOB_MS( 1 ) ) {
+			clock.advance( 1 );
+			looped.loop();
+		}
+	}
+}
+}
+
+#endif
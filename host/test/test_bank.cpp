@@ -0,0 +1,203 @@
+/*
+ * KnobBank: The vertical counters debounce every Key on its own and
+ * Keys' handlers see the same as on a Knob.
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+#include "KnobBank.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+#define PIN 20
+
+static VirtualClock vclock;
+
+// bank of keys given as mask
+class Board : public KnobBank {
+
+	public:
+		bank_mask_t raw;
+
+		Board() : KnobBank( "board" ), raw( 0 ) {}
+
+	protected:
+		virtual bank_mask_t _sample() {
+			return raw;
+		}
+};
+
+// loop until the masked state of bank is state, max. ms.
+// Returns ms looped or -1
+static knob_time_t until( KnobBank &bank, bank_mask_t mask, bank_mask_t state, knob_time_t ms ) {
+
+	for( knob_time_t i = 1; i <= ms; i++ ) {
+		vclock.advance( 1 );
+		bank.loop();
+		if( ( bank.state() & mask ) == state ) return i;
+	}
+
+	return -1;
+}
+
+static void testDebounce() {
+
+	Key k0( "k0", PIN ), k1( "k1", PIN+1 ), k2( "k2", PIN+2 );
+	KnobBank bank( "bank" );
+	Push push( record );
+	Release release( record );
+
+	bank << k0 << k1 << k2;
+	k1.on( push ).on( release );
+	forget();
+
+	runFor( bank, vclock, KNOB_MS( 100 ) );
+	CHECK_EQ( bank.state(), 0 );
+
+	// 4 samples every 25/4 ms in a row, seen by the 1 ms loop
+	sim().input( PIN+1, HIGH );
+	knob_time_t sample = KNOB_MS( 25 ) / 4,
+	            took = KNOB_MS( until( bank, 2, 2, 100 ) );
+	CHECK( took >= 3*sample );
+	CHECK( took <= 4*sample + KNOB_MS( 1 ) );
+	CHECK_EQ( bank.state(), 2 );
+	CHECK_EQ( k1.value(), 1 );
+	CHECK_EQ( callsOf( HT_PUSH ), 1 );
+
+	// bouncing resets the counter
+	sim().input( PIN, HIGH );
+	for( int i = 0; i < 20; i++ ) {
+		runFor( bank, vclock, KNOB_MS( 12 ) );
+		sim().input( PIN, i % 2 ? HIGH : LOW );
+	}
+	CHECK_EQ( bank.state(), 2 );
+	// ends low, so it never got through
+	sim().input( PIN, LOW );
+	runFor( bank, vclock, KNOB_MS( 100 ) );
+	CHECK_EQ( bank.state(), 2 );
+
+	// counters of other keys run independently
+	sim().input( PIN+1, LOW );
+	runFor( bank, vclock, KNOB_MS( 12 ) );
+	sim().input( PIN+2, HIGH );
+	took = until( bank, 6, 4, 100 );
+	CHECK( took > 0 );
+	CHECK_EQ( bank.state(), 4 );
+	CHECK_EQ( callsOf( HT_RELEASE ), 1 );
+
+	sim().input( PIN+2, LOW );
+	runFor( bank, vclock, KNOB_MS( 100 ) );
+	CHECK_EQ( bank.state(), 0 );
+	CHECK_EQ( callsOf( HT_PUSH ), 1 );
+	CHECK_EQ( callsOf( HT_RELEASE ), 1 );
+}
+
+static void testKeyCount() {
+
+	Key k0( "k0", PIN+3 );
+	KnobBank bank( "bank" );
+	Hold hold( record, KNOB_MS( 300 ) );
+
+	bank << k0;
+	k0.on( hold );
+	forget();
+
+	runFor( bank, vclock, KNOB_MS( 100 ) );
+
+	sim().input( PIN+3, HIGH );
+	CHECK( until( bank, 1, 1, 100 ) > 0 );
+	knob_time_t debounced = now();
+
+	runFor( bank, vclock, KNOB_MS( 500 ) );
+	sim().input( PIN+3, LOW );
+	runFor( bank, vclock, KNOB_MS( 100 ) );
+
+	// counted like on a Knob: the loop of the change counts
+	CHECK_EQ( callsOf( HT_HOLD ), 1 );
+	if( CHECK( firstOf( HT_HOLD ) ) ) {
+		CHECK_EQ( firstOf( HT_HOLD )->count, KNOB_MS( 300 ) );
+		CHECK_EQ( firstOf( HT_HOLD )->time - debounced, KNOB_MS( 300 - 1 ) );
+	}
+}
+
+// the bank's handlers see the keys down, whichever they are
+static void testBankHandlers() {
+
+	Board board;
+	Push push( record );
+	Release release( record );
+	Over chord( record, 2 );
+
+	board.on( push ).on( release ).on( chord );
+	runFor( board, vclock, KNOB_MS( 100 ) );
+	forget();
+
+	board.raw = (bank_mask_t)1 << ( KNOBS_BANK_WIDTH - 1 );
+	runFor( board, vclock, KNOB_MS( 50 ) );
+	CHECK_EQ( callsOf( HT_PUSH ), 1 );
+	if( CHECK( firstOf( HT_PUSH ) ) ) {
+		CHECK_EQ( firstOf( HT_PUSH )->newState, 1 );
+	}
+
+	board.raw |= 1;
+	runFor( board, vclock, KNOB_MS( 50 ) );
+	CHECK_EQ( callsOf( HT_PUSH ), 1 );
+	CHECK_EQ( callsOf( HT_OVER ), 1 );
+	CHECK_EQ( board.state(), board.raw );
+
+	board.raw = 1;
+	runFor( board, vclock, KNOB_MS( 50 ) );
+	CHECK_EQ( callsOf( HT_RELEASE ), 0 );
+
+	board.raw = 0;
+	runFor( board, vclock, KNOB_MS( 50 ) );
+	CHECK_EQ( callsOf( HT_RELEASE ), 1 );
+}
+
+// the bank's own Hold counts from the last change of the bank's state
+static void testBankHold() {
+
+	Board board;
+	Hold hold( record, KNOB_MS( 500 ) );
+
+	board.on( hold );
+	runFor( board, vclock, KNOB_MS( 100 ) );
+	forget();
+
+	board.raw = 1;
+	runFor( board, vclock, KNOB_MS( 50 ) );
+	CHECK_EQ( board.state(), 1 );
+
+	// no counter running: Hold tells
+	knob_time_t wait = board.due( now() );
+	CHECK( wait > 0 && wait < KNOB_MS( 500 ) );
+
+	runFor( board, vclock, wait );
+	CHECK_EQ( callsOf( HT_HOLD ), 1 );
+	if( CHECK( firstOf( HT_HOLD ) ) ) {
+		CHECK_EQ( firstOf( HT_HOLD )->count, KNOB_MS( 500 ) );
+	}
+
+	// a short press after a long release doesn't hold
+	board.raw = 0;
+	runFor( board, vclock, KNOB_MS( 1000 ) );
+	board.raw = 2;
+	runFor( board, vclock, KNOB_MS( 300 ) );
+	board.raw = 0;
+	runFor( board, vclock, KNOB_MS( 300 ) );
+	CHECK_EQ( callsOf( HT_HOLD ), 1 );
+}
+
+int main() {
+
+	use( vclock );
+
+	testDebounce();
+	testKeyCount();
+	testBankHandlers();
+	testBankHold();
+
+	return checkResult();
+}
@@ -0,0 +1,91 @@
+/*
+ * Clock: uptime() goes on past the wrap of the 32 bit counter (49 days
+ * of millis(), 71 minutes of micros()) and so do the devices using it.
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+#define DEBOUNCE KNOB_MS( 25 )
+
+// uptime() where the 32 bit counter wraps
+#define WRAP ( (knob_time_t)1 << 32 )
+
+static VirtualClock vclock;
+
+// start over at knob time 'time'
+static void startAt( knob_time_t time ) {
+
+	vclock.set( time * 1000 / KNOB_MS( 1 ) );
+	// resets uptime()
+	use( vclock );
+}
+
+static void testWrap() {
+
+	startAt( WRAP - KNOB_MS( 10 ) );
+
+	knob_time_t before = uptime();
+	uint32_t raw = clockRead();
+
+	CHECK_EQ( before, WRAP - KNOB_MS( 10 ) );
+
+	pass( vclock, KNOB_MS( 20 ) );
+
+	knob_time_t after = uptime();
+
+	CHECK_EQ( after, WRAP + KNOB_MS( 10 ) );
+	CHECK_EQ( now(), after );
+
+	// counter read before the wrap
+	CHECK_EQ( uptimeOf( raw, after ), before );
+
+	// counter read after uptime(), e.g. by an interrupt
+	pass( vclock, KNOB_MS( 1 ) );
+	CHECK_EQ( uptimeOf( clockRead(), after ), after + KNOB_MS( 1 ) );
+
+	// the next wrap, as long as uptime() is called in between
+	pass( vclock, WRAP / 2 );
+	CHECK_EQ( uptime(), WRAP + WRAP / 2 + KNOB_MS( 11 ) );
+	pass( vclock, WRAP / 2 );
+	CHECK_EQ( uptime(), 2*WRAP + KNOB_MS( 11 ) );
+}
+
+static void testHoldOverWrap() {
+
+	startAt( WRAP - KNOB_MS( 300 ) );
+
+	Knob knob( "hold", 2 );
+	Hold hold( record, KNOB_MS( 500 ) );
+
+	knob.on( hold );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	forget();
+
+	knob_time_t pressed = now();
+	sim().input( 2, HIGH );
+
+	runFor( knob, vclock, KNOB_MS( 1000 ) );
+
+	CHECK_EQ( callsOf( HT_HOLD ), 1 );
+	if( CHECK( firstOf( HT_HOLD ) ) ) {
+		CHECK( firstOf( HT_HOLD )->time > WRAP );
+		CHECK_EQ( firstOf( HT_HOLD )->time - pressed, DEBOUNCE + KNOB_MS( 500 ) );
+		CHECK_EQ( firstOf( HT_HOLD )->count, KNOB_MS( 500 ) );
+	}
+
+	sim().input( 2, LOW );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+}
+
+int main() {
+
+	testWrap();
+	testHoldOverWrap();
+
+	return checkResult();
+}
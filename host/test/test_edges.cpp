@@ -0,0 +1,128 @@
+/*
+ * Knob in interrupt mode: Edges injected through the SimHal's
+ * interrupts are debounced from their timestamps, so handlers see
+ * exact times however seldom loop is called.
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+#define PIN 12
+
+// debounce of Knob
+#define DEBOUNCE KNOB_MS( 25 )
+
+static VirtualClock vclock;
+
+// set pin and let ms pass without looping
+static void edge( value_t level, knob_time_t ms ) {
+
+	sim().input( PIN, level );
+	vclock.advance( ms );
+}
+
+static void testBurst() {
+
+	Knob knob( "irq", PIN );
+	Push push( record );
+	Release release( record );
+
+	knob.on( push ).on( release );
+	knob.interrupt( true );
+	CHECK( knob.interrupted() );
+
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	forget();
+
+	// bouncing press, looped every 50 ms only
+	knob_time_t pressed = now();
+	edge( HIGH, 1 );
+	edge( LOW, 2 );
+	edge( HIGH, 1 );
+	edge( LOW, 1 );
+	edge( HIGH, 45 );
+	knob.loop();
+
+	CHECK_EQ( callsOf( HT_PUSH ), 1 );
+	if( CHECK( firstOf( HT_PUSH ) ) ) {
+		// time of the first edge
+		CHECK_EQ( firstOf( HT_PUSH )->time, pressed );
+	}
+
+	vclock.advance( 50 );
+	knob.loop();
+
+	// nothing planned
+	CHECK_EQ( knob.due( now() ), KNOB_TIME_NEVER );
+
+	// a spike shorter than debounce. Edges waiting must be looked at.
+	edge( LOW, 3 );
+	edge( HIGH, 3 );
+	CHECK_EQ( knob.due( now() ), 0 );
+	knob.loop();
+	// back where it was
+	CHECK_EQ( knob.due( now() ), KNOB_TIME_NEVER );
+	vclock.advance( 50 );
+	knob.loop();
+	CHECK_EQ( callsOf( HT_RELEASE ), 0 );
+
+	// release
+	knob_time_t released = now();
+	edge( LOW, 5 );
+	knob.loop();
+	CHECK_EQ( knob.due( now() ), DEBOUNCE - KNOB_MS( 5 ) );
+	vclock.advance( 45 );
+	knob.loop();
+	CHECK_EQ( callsOf( HT_RELEASE ), 1 );
+	if( CHECK( firstOf( HT_RELEASE ) ) ) {
+		CHECK_EQ( firstOf( HT_RELEASE )->time, released );
+	}
+
+	CHECK_EQ( knob.value(), 0 );
+
+	knob.interrupt( false );
+	CHECK( !knob.interrupted() );
+}
+
+static void testOverrun() {
+
+	Knob knob( "overrun", PIN );
+	Push push( record );
+
+	knob.on( push );
+	knob.interrupt( true );
+
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	forget();
+
+	// more edges than fit. Ends high.
+	for( int i = 0; i < KNOBS_EDGE_BUFFER * 2; i++ ) edge( i % 2 ? LOW : HIGH, 1 );
+	edge( HIGH, 100 );
+
+	// resynced with the pin
+	knob.loop();
+	pass( vclock, DEBOUNCE );
+	knob.loop();
+	CHECK_EQ( knob.value(), 1 );
+	CHECK_EQ( callsOf( HT_PUSH ), 1 );
+
+	sim().input( PIN, LOW );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	CHECK_EQ( knob.value(), 0 );
+
+	knob.interrupt( false );
+}
+
+int main() {
+
+	use( vclock );
+
+	testBurst();
+	testOverrun();
+
+	return checkResult();
+}
@@ -0,0 +1,137 @@
+/*
+ * Encoder: Quadrature sequences count detents in both directions,
+ * half turns and invalid transitions are not counted and edges seen
+ * by interrupt need no loop in between.
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+#include "Encoder.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+#define PIN_A 20
+#define PIN_B 21
+
+static VirtualClock vclock;
+
+// one detent clockwise: AB 00 10 11 01 00
+static const uint8_t _CW[ 4 ] = { 2, 3, 1, 0 };
+// counter clockwise: AB 00 01 11 10 00
+static const uint8_t _CCW[ 4 ] = { 1, 3, 2, 0 };
+
+// set lines to AB, loop if looped
+static void lines( uint8_t ab, Encoder *looped ) {
+
+	sim().input( PIN_A, ab & 2 ? HIGH : LOW );
+	sim().input( PIN_B, ab & 1 ? HIGH : LOW );
+
+	vclock.advance( 1 );
+	if( looped ) looped->loop();
+}
+
+// quarters of a detent in direction seq, from quarter 'from' on
+static void turn( const uint8_t *seq, int quarters, Encoder *looped, int from=0 ) {
+
+	for( int i = from; i < from + quarters; i++ ) lines( seq[ i % 4 ], looped );
+}
+
+static void testQuadrature() {
+
+	Encoder enc( "enc", PIN_A, PIN_B );
+	Toggle toggle( record );
+
+	lines( 0, &enc );
+	enc.on( toggle );
+	forget();
+
+	// 3 detents
+	turn( _CW, 3*4, &enc );
+	CHECK_EQ( enc.value(), 3 );
+	CHECK_EQ( callsOf( HT_TOGGLE ), 3 );
+	if( CHECK( nCalls >= 1 ) ) {
+		CHECK_EQ( calls[ nCalls-1 ].newState, 3 );
+		CHECK_EQ( calls[ nCalls-1 ].oldState, 2 );
+	}
+
+	// reversal
+	turn( _CCW, 2*4, &enc );
+	CHECK_EQ( enc.value(), 1 );
+	CHECK_EQ( callsOf( HT_TOGGLE ), 5 );
+
+	// half a detent and back counts nothing
+	turn( _CW, 2, &enc );
+	CHECK_EQ( enc.value(), 1 );
+	lines( _CW[ 0 ], &enc );
+	lines( 0, &enc );
+	CHECK_EQ( enc.value(), 1 );
+	CHECK_EQ( callsOf( HT_TOGGLE ), 5 );
+
+	// both lines at once is invalid and ignored
+	lines( 3, &enc );
+	lines( 0, &enc );
+	CHECK_EQ( enc.value(), 1 );
+
+	// reversal within a detent: 3 quarters forward, 3 back
+	turn( _CW, 3, &enc );
+	turn( _CCW, 3, &enc, 1 );
+	CHECK_EQ( enc.value(), 1 );
+
+	enc.invert( true );
+	turn( _CW, 4, &enc );
+	CHECK_EQ( enc.value(), 0 );
+}
+
+static void testSteps() {
+
+	Encoder enc( "steps", PIN_A, PIN_B );
+
+	lines( 0, &enc );
+	enc.steps( 2 ).range( -2, 2 );
+
+	// a detent at every other edge
+	turn( _CW, 2, &enc );
+	CHECK_EQ( enc.value(), 1 );
+
+	// limited
+	turn( _CW, 8, &enc, 2 );
+	CHECK_EQ( enc.value(), 2 );
+	turn( _CCW, 4*4, &enc );
+	CHECK_EQ( enc.value(), -2 );
+}
+
+static void testInterrupt() {
+
+	Encoder enc( "irq", PIN_A, PIN_B );
+
+	lines( 0, NULL );
+	enc.interrupt( true );
+	CHECK( enc.interrupted() );
+	enc.loop();
+
+	CHECK_EQ( enc.due( now() ), KNOB_TIME_NEVER );
+
+	// no loop in between
+	turn( _CW, 5*4, NULL );
+	turn( _CCW, 2*4, NULL );
+	CHECK_EQ( enc.due( now() ), 0 );
+
+	enc.loop();
+	CHECK_EQ( enc.value(), 3 );
+
+	enc.interrupt( false );
+	CHECK( !enc.interrupted() );
+}
+
+int main() {
+
+	use( vclock );
+
+	testQuadrature();
+	testSteps();
+	testInterrupt();
+
+	return checkResult();
+}
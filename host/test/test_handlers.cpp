@@ -0,0 +1,334 @@
+/*
+ * Handlers on a polled Knob: timing of Hold and DoubleClick and
+ * which activations reach a Handler because of its interest.
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+// debounce of Knob
+#define DEBOUNCE KNOB_MS( 25 )
+
+static VirtualClock vclock;
+
+// counts handle() calls of the activations it is interested in
+class Counter : public Handler {
+
+	public:
+		int rises, falls, highs, lows;
+
+		Counter( uint8_t interest ) : Handler( HT_ALWAYS, record ) {
+
+			_interest = interest;
+			rises = falls = highs = lows = 0;
+		}
+
+		virtual bool handle( Device &dev,
+				knob_value_t newState, knob_value_t oldState, knob_time_t time ) {
+
+			switch( interestOf( newState, oldState ) ) {
+				case IN_RISE: rises++; break;
+				case IN_FALL: falls++; break;
+				case IN_HIGH: highs++; break;
+				case IN_LOW: lows++; break;
+			}
+
+			return true;
+		}
+};
+
+// Device showing whatever it is set to
+class Dial : public Device {
+
+	private:
+		knob_value_t _value;
+
+	public:
+		Dial( const char *name ) : Device( name ), _value( 0 ) {}
+
+		void set( knob_value_t value ) {
+
+			knob_value_t old = _value;
+
+			_value = value;
+			_activate( value, old, 0, now() );
+		}
+
+		virtual void loop() {
+			_activate( _value, _value, 0, now() );
+		}
+};
+
+static void testHold() {
+
+	Knob knob( "hold", 2 );
+	Hold hold( record, KNOB_MS( 500 ) );
+
+	knob.on( hold );
+	forget();
+
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+
+	knob_time_t pressed = now();
+	sim().input( 2, HIGH );
+
+	runFor( knob, vclock, KNOB_MS( 1000 ) );
+
+	// once, after debouncing and holding
+	CHECK_EQ( callsOf( HT_HOLD ), 1 );
+	if( CHECK( firstOf( HT_HOLD ) ) ) {
+		CHECK_EQ( firstOf( HT_HOLD )->time - pressed, DEBOUNCE + KNOB_MS( 500 ) );
+		CHECK_EQ( firstOf( HT_HOLD )->count, KNOB_MS( 500 ) );
+	}
+
+	// again after release and press
+	sim().input( 2, LOW );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	sim().input( 2, HIGH );
+	runFor( knob, vclock, KNOB_MS( 300 ) );
+	CHECK_EQ( callsOf( HT_HOLD ), 1 );
+	runFor( knob, vclock, KNOB_MS( 300 ) );
+	CHECK_EQ( callsOf( HT_HOLD ), 2 );
+
+	sim().input( 2, LOW );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+}
+
+static void testHoldContinues() {
+
+	Knob knob( "repeat", 3 );
+	Hold hold( record, KNOB_MS( 200 ) );
+
+	hold.continues( true );
+	knob.on( hold );
+	forget();
+
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+
+	sim().input( 3, HIGH );
+	runFor( knob, vclock, DEBOUNCE + KNOB_MS( 200 ) );
+	CHECK_EQ( callsOf( HT_HOLD ), 1 );
+
+	// every loop from then on
+	runFor( knob, vclock, KNOB_MS( 10 ) );
+	CHECK_EQ( callsOf( HT_HOLD ), 11 );
+
+	// the loop seeing the release still counts the time before as held
+	sim().input( 3, LOW );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	CHECK_EQ( callsOf( HT_HOLD ), 12 );
+}
+
+// a glitch seen by the first loop after a long idle isn't debounced
+static void testIdleGlitch() {
+
+	Knob knob( "idle", 4 );
+	Push push( record );
+
+	knob.on( push );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	forget();
+
+	// nothing due: slept until the pin changed
+	CHECK_EQ( knob.due( now() ), KNOB_TIME_NEVER );
+	vclock.advance( 5000 );
+	sim().input( 4, HIGH );
+	knob.loop();
+	CHECK_EQ( knob.due( now() ), DEBOUNCE );
+
+	vclock.advance( 1 );
+	sim().input( 4, LOW );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	CHECK_EQ( callsOf( HT_PUSH ), 0 );
+
+	// a real press after an idle: due tells when it is through
+	vclock.advance( 5000 );
+	sim().input( 4, HIGH );
+	knob_time_t pressed = now();
+	knob.loop();
+	pass( vclock, knob.due( now() ) );
+	knob.loop();
+	CHECK_EQ( callsOf( HT_PUSH ), 1 );
+	if( CHECK( firstOf( HT_PUSH ) ) ) {
+		CHECK_EQ( firstOf( HT_PUSH )->time - pressed, DEBOUNCE );
+	}
+
+	sim().input( 4, LOW );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+}
+
+// press for 'down', then release for 'up'
+static void click( Knob &knob, knob_time_t down, knob_time_t up ) {
+
+	sim().input( knob.pin(), HIGH );
+	runFor( knob, vclock, down );
+	sim().input( knob.pin(), LOW );
+	runFor( knob, vclock, up );
+}
+
+static void testDoubleClick() {
+
+	Knob knob( "double", 4 );
+	DoubleClick twice( record );
+
+	knob.on( twice );
+	forget();
+
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+
+	// two clicks in time
+	click( knob, KNOB_MS( 100 ), KNOB_MS( 200 ) );
+	CHECK_EQ( callsOf( HT_DOUBLECLICK ), 0 );
+	click( knob, KNOB_MS( 100 ), KNOB_MS( 200 ) );
+	CHECK_EQ( callsOf( HT_DOUBLECLICK ), 1 );
+	if( CHECK( firstOf( HT_DOUBLECLICK ) ) ) {
+		// from first to second release
+		CHECK_EQ( firstOf( HT_DOUBLECLICK )->count, KNOB_MS( 300 ) );
+	}
+
+	// too slow
+	forget();
+	runFor( knob, vclock, KNOB_MS( 1000 ) );
+	click( knob, KNOB_MS( 100 ), KNOB_MS( 800 ) );
+	click( knob, KNOB_MS( 100 ), KNOB_MS( 800 ) );
+	CHECK_EQ( callsOf( HT_DOUBLECLICK ), 0 );
+}
+
+static void testInterest() {
+
+	Knob knob( "interest", 5 );
+	Counter changes( IN_CHANGE ),
+	        rises( IN_RISE ),
+	        steady( IN_STEADY );
+
+	knob.on( changes ).on( rises ).on( steady );
+
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	click( knob, KNOB_MS( 100 ), KNOB_MS( 100 ) );
+
+	CHECK_EQ( changes.rises, 1 );
+	CHECK_EQ( changes.falls, 1 );
+	CHECK_EQ( changes.highs + changes.lows, 0 );
+
+	CHECK_EQ( rises.rises, 1 );
+	CHECK_EQ( rises.falls + rises.highs + rises.lows, 0 );
+
+	CHECK_EQ( steady.rises + steady.falls, 0 );
+	CHECK( steady.highs > 0 );
+	CHECK( steady.lows > 0 );
+
+	// Push and Release only want changes
+	CHECK_EQ( Push( record ).interest() & IN_STEADY, 0 );
+	CHECK_EQ( Release( record ).interest() & IN_STEADY, 0 );
+}
+
+// on is != 0. So negative states are on, too.
+static void testNegative() {
+
+	Dial dial( "dial" );
+	Push push( record );
+	Release release( record );
+	Over over( record, 0 );
+	Under under( record, 0 );
+
+	dial.on( push ).on( release ).on( over ).on( under );
+	forget();
+
+	dial.set( -5 );
+	dial.set( 0 );
+	dial.set( 5 );
+	dial.set( 0 );
+
+	CHECK_EQ( callsOf( HT_PUSH ), 2 );
+	CHECK_EQ( callsOf( HT_RELEASE ), 2 );
+	// numerically up and down
+	CHECK_EQ( callsOf( HT_OVER ), 1 );
+	CHECK_EQ( callsOf( HT_UNDER ), 1 );
+
+	// on -> on isn't a push
+	forget();
+	dial.set( -5 );
+	dial.set( 5 );
+	CHECK_EQ( callsOf( HT_PUSH ), 1 );
+	CHECK_EQ( callsOf( HT_RELEASE ), 0 );
+}
+
+// Devices which are full take slots from the Shelf and give them back
+static void testShelf() {
+
+	typedef Shelf<Handler, KNOBS_HANDLER_SLOTS> Slots;
+
+	if( Slots::capacity() < 8 ) return;
+
+	int used = Slots::used();
+
+	{
+		Dial a( "a" ), b( "b" ), c( "c" );
+		Handler *own[ 3 ][ 1 ];
+		Push p1( record ), p2( record ), p3( record ), p4( record ),
+				p5( record ), p6( record ), p7( record ), p8( record );
+
+		// storage for one handler each
+		a.handlers( own[ 0 ], 1 );
+		b.handlers( own[ 1 ], 1 );
+		c.handlers( own[ 2 ], 1 );
+
+		a.on( p1 ).on( p2 );
+		b.on( p3 ).on( p4 );
+		CHECK_EQ( Slots::used() - used, 2 + 2 );
+
+		// a moves behind b and gives its slots back
+		a.on( p5 );
+		CHECK_EQ( Slots::used() - used, 2 + 3 );
+
+		// in place
+		a.on( p6 );
+		CHECK_EQ( Slots::used() - used, 2 + 4 );
+
+		// in the slots a left
+		c.on( p7 ).on( p8 );
+		CHECK_EQ( Slots::used() - used, 2 + 4 + 2 );
+		CHECK_EQ( c.handlerOverflow(), 0 );
+
+		forget();
+		a.set( 1 );
+		b.set( 1 );
+		c.set( 1 );
+		CHECK_EQ( callsOf( HT_PUSH ), 8 );
+
+		// exhausted
+		int overflows = canisterOverflows();
+		Push more( record );
+
+		while( !c.handlerOverflow() ) c.on( more );
+		CHECK_EQ( canisterOverflows() - overflows, 1 );
+
+		// c keeps the handlers it has
+		forget();
+		c.set( 0 );
+		c.set( 1 );
+		CHECK( callsOf( HT_PUSH ) >= 2 );
+	}
+
+	// given back when the Devices are gone
+	CHECK_EQ( Slots::used(), used );
+}
+
+int main() {
+
+	use( vclock );
+
+	testHold();
+	testHoldContinues();
+	testIdleGlitch();
+	testDoubleClick();
+	testInterest();
+	testNegative();
+	testShelf();
+
+	return checkResult();
+}
@@ -0,0 +1,142 @@
+/*
+ * Keypad: A simulated matrix without diodes is scanned row by row.
+ * Keys map to r*columns+c, only one row is driven at a time and
+ * three keys in a rectangle make the fourth one ghost like they do on
+ * the real thing.
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+#include "Keypad.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+#define ROWS 3
+#define COLS 3
+
+static VirtualClock vclock;
+
+// Columns are pulled up and pulled low through closed keys by a row
+// driven low. Closed keys also connect rows with each other.
+class Matrix : public SimHal {
+
+	private:
+		const pin_t *_rows, *_cols;
+
+	public:
+		bool closed[ ROWS ][ COLS ];
+		// most rows driven at once
+		int maxDriven;
+
+		Matrix( const pin_t *rows, const pin_t *cols )
+				: _rows( rows ), _cols( cols ), maxDriven( 0 ) {
+			open();
+		}
+
+		void open() {
+			memset( closed, 0, sizeof( closed ) );
+		}
+
+		virtual int digitalRead( pin_t pin ) {
+
+			int col = -1, driven = 0;
+			bool row[ ROWS ], low[ COLS ], more = true;
+
+			for( int c = 0; c < COLS; c++ ) if( _cols[ c ] == pin ) col = c;
+			if( col < 0 ) return SimHal::digitalRead( pin );
+
+			for( int r = 0; r < ROWS; r++ ) {
+				row[ r ] = mode( _rows[ r ] ) == OUTPUT && output( _rows[ r ] ) == LOW;
+				if( row[ r ] ) driven++;
+			}
+			if( driven > maxDriven ) maxDriven = driven;
+
+			for( int c = 0; c < COLS; c++ ) low[ c ] = false;
+
+			// spread the low level through closed keys
+			while( more ) {
+				more = false;
+				for( int r = 0; r < ROWS; r++ ) for( int c = 0; c < COLS; c++ ) {
+					if( !closed[ r ][ c ] || row[ r ] == low[ c ] ) continue;
+					row[ r ] = low[ c ] = more = true;
+				}
+			}
+
+			return low[ col ] ? LOW : HIGH;
+		}
+};
+
+// debounced state after the keys settled
+static bank_mask_t scan( Keypad &pad ) {
+
+	runFor( pad, vclock, KNOB_MS( 50 ) );
+
+	return pad.state();
+}
+
+static void testMatrix( const pin_t *rows, const pin_t *cols ) {
+
+	Matrix matrix( rows, cols );
+
+	use( matrix );
+
+	Keypad pad( "pad", rows, ROWS, cols, COLS );
+	Crate<Key, ROWS*COLS> keys;
+	char names[ ROWS*COLS ][ 4 ];
+	Push push( record );
+
+	for( int k = 0; k < ROWS*COLS; k++ ) {
+		snprintf( names[ k ], sizeof( names[ k ] ), "k%d", k );
+		pad << *keys.make( names[ k ] );
+	}
+	keys.get( 1*COLS + 2 )->on( push );
+
+	CHECK_EQ( scan( pad ), 0 );
+
+	// row 1, column 2
+	forget();
+	matrix.closed[ 1 ][ 2 ] = true;
+	CHECK_EQ( scan( pad ), 1 << ( 1*COLS + 2 ) );
+	CHECK_EQ( keys.get( 1*COLS + 2 )->value(), 1 );
+	CHECK_EQ( callsOf( HT_PUSH ), 1 );
+
+	// two keys in one row
+	matrix.open();
+	matrix.closed[ 0 ][ 0 ] = matrix.closed[ 0 ][ 1 ] = true;
+	CHECK_EQ( scan( pad ), ( 1 << 0 ) | ( 1 << 1 ) );
+
+	// ghost: 0,0 0,1 and 2,0 closed make 2,1 appear
+	matrix.closed[ 2 ][ 0 ] = true;
+	CHECK_EQ( scan( pad ), ( 1 << 0 ) | ( 1 << 1 ) | ( 1 << 2*COLS ) | ( 1 << ( 2*COLS + 1 ) ) );
+
+	// keys on one diagonal don't ghost
+	matrix.open();
+	for( int i = 0; i < ROWS; i++ ) matrix.closed[ i ][ i ] = true;
+	CHECK_EQ( scan( pad ), ( 1 << 0 ) | ( 1 << ( COLS + 1 ) ) | ( 1 << ( 2*COLS + 2 ) ) );
+
+	matrix.open();
+	CHECK_EQ( scan( pad ), 0 );
+
+	// one row at a time, floating afterwards
+	CHECK_EQ( matrix.maxDriven, 1 );
+	for( int r = 0; r < ROWS; r++ ) CHECK_EQ( matrix.mode( rows[ r ] ), INPUT );
+
+	use( sim() );
+}
+
+int main() {
+
+	// columns on one port (read at once) and on different ports
+	static const pin_t rows[ ROWS ] = { 10, 11, 12 },
+	                   port[ COLS ] = { 16, 17, 18 },
+	                   pins[ COLS ] = { 20, 29, 38 };
+
+	use( vclock );
+
+	testMatrix( rows, port );
+	testMatrix( rows, pins );
+
+	return checkResult();
+}
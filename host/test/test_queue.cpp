@@ -0,0 +1,172 @@
+/*
+ * EventQueue: Activations wait in order with their time, the ones
+ * which don't fit are counted.
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+#include "EventQueue.h"
+#include "Lever.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+static VirtualClock vclock;
+
+static void testOverflow() {
+
+	Knob knob( "queued", 6 );
+	Always always( record );
+	EventQueue queue;
+
+	knob.on( always ).queue( queue );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	queue.dispatch();
+	queue.reset();
+	forget();
+
+	CHECK_EQ( queue.capacity(), KNOBS_EVENT_QUEUE_SIZE - 1 );
+
+	// Always is activated every loop
+	knob_time_t start = now();
+	runFor( knob, vclock, KNOB_MS( KNOBS_EVENT_QUEUE_SIZE + 9 ) );
+
+	CHECK_EQ( nCalls, 0 );
+	CHECK_EQ( queue.fill(), queue.capacity() );
+	CHECK_EQ( queue.highWater(), queue.capacity() );
+	CHECK_EQ( queue.overflows(), 10 );
+
+	// the oldest ones are kept and run with their time
+	CHECK_EQ( queue.dispatch(), queue.capacity() );
+	CHECK_EQ( nCalls, queue.capacity() );
+	CHECK_EQ( calls[ 0 ].time, start + KNOB_MS( 1 ) );
+	CHECK_EQ( calls[ queue.capacity() - 1 ].time, start + KNOB_MS( queue.capacity() ) );
+
+	CHECK_EQ( queue.fill(), 0 );
+	CHECK_EQ( queue.dispatch(), 0 );
+
+	// room again
+	runFor( knob, vclock, KNOB_MS( 3 ) );
+	CHECK_EQ( queue.fill(), 3 );
+	CHECK_EQ( queue.overflows(), 10 );
+
+	// times are kept as clock counter
+	Event event;
+	CHECK( queue.pop( event ) );
+	CHECK( queue.device( event.device ) == &knob );
+	CHECK_EQ( uptimeOf( event.now, now() ), now() - KNOB_MS( 2 ) );
+
+	queue.reset();
+	CHECK_EQ( queue.overflows(), 0 );
+	CHECK_EQ( queue.highWater(), 0 );
+
+	knob.unqueue();
+}
+
+static void testOrder() {
+
+	Knob a( "a", 7 ), b( "b", 8 );
+	Push push( record );
+	EventQueue queue;
+	Panel panel( "panel", a, b );
+
+	a.on( push );
+	b.on( push );
+	panel.queue( queue );
+
+	runFor( panel, vclock, KNOB_MS( 100 ) );
+	queue.dispatch();
+	forget();
+
+	sim().input( 8, HIGH );
+	runFor( panel, vclock, KNOB_MS( 10 ) );
+	sim().input( 7, HIGH );
+	runFor( panel, vclock, KNOB_MS( 30 ) );
+	queue.dispatch();
+
+	if( CHECK_EQ( nCalls, 2 ) ) {
+		CHECK_EQ( calls[ 1 ].time - calls[ 0 ].time, KNOB_MS( 10 ) );
+	}
+}
+
+// coalescing would ask the handlers while the consumer runs them
+static void testCoalesce() {
+
+	Knob knob( "coalesced", 9 );
+	Hold hold( record, KNOB_MS( 1000 ) );
+	EventQueue queue;
+
+	knob.on( hold ).coalesce( true );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	forget();
+
+	sim().input( 9, HIGH );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+
+	// held: nothing to do until Hold is due
+	knob.queue( queue );
+	runFor( knob, vclock, KNOB_MS( 10 ) );
+	CHECK_EQ( queue.fill(), 10 );
+
+	knob.unqueue();
+	queue.dispatch();
+	runFor( knob, vclock, KNOB_MS( 10 ) );
+	CHECK_EQ( queue.fill(), 0 );
+
+	// and woken when it is
+	runFor( knob, vclock, KNOB_MS( 1000 ) );
+	CHECK_EQ( callsOf( HT_HOLD ), 1 );
+
+	sim().input( 9, LOW );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	CHECK_EQ( callsOf( HT_HOLD ), 1 );
+}
+
+static Lever *producer;
+static int interrupts;
+
+// samples once more while the consumer runs the handlers, as an
+// interrupt would
+static bool interrupted( Device &dev, Handler &handler,
+		knob_value_t newState, knob_value_t oldState, knob_time_t count ) {
+
+	if( !interrupts++ ) {
+		vclock.advance( 1 );
+		producer->loop();
+	}
+
+	return record( dev, handler, newState, oldState, count );
+}
+
+// the producer doesn't change the time the consumer's handlers see
+static void testProducerTime() {
+
+	Lever lever( "lever", 10, 0, 1023 );
+	Always always( interrupted );
+	EventQueue queue;
+
+	producer = &lever;
+	interrupts = 0;
+	lever.on( always ).queue( queue );
+
+	knob_time_t start = now();
+	runFor( lever, vclock, KNOB_MS( 3 ) );
+	forget();
+
+	CHECK_EQ( queue.dispatch(), 4 );
+	CHECK_EQ( nCalls, 4 );
+	for( int i = 0; i < nCalls; i++ ) CHECK_EQ( calls[ i ].time, start + KNOB_MS( i + 1 ) );
+}
+
+int main() {
+
+	use( vclock );
+
+	testOverflow();
+	testOrder();
+	testCoalesce();
+	testProducerTime();
+
+	return checkResult();
+}
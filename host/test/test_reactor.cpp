@@ -0,0 +1,99 @@
+/*
+ * Reactor: The timerfd is armed to the next due() of its Panels, so a
+ * press is handled once it is debounced and nothing wakes it when idle.
+ * Runs on the SystemClock, so times are checked loosely.
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+#include "Reactor.h"
+
+#include <poll.h>
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+#define PIN 20
+
+// debounce of Knob
+#define DEBOUNCE KNOB_MS( 25 )
+
+static bool readable( int fd, int timeout ) {
+
+	struct pollfd pfd = { fd, POLLIN, 0 };
+
+	return poll( &pfd, 1, timeout ) == 1;
+}
+
+static void testArming() {
+
+	Knob knob( "button", PIN );
+	Push push( record );
+	Panel panel( "panel", knob );
+	Reactor reactor;
+
+	if( !CHECK( reactor.fd() >= 0 ) ) return;
+
+	knob.on( push );
+	reactor << panel;
+
+	// settle. Nothing due afterwards
+	reactor.service( 0 );
+	clock().sleep( 30000 );
+	reactor.service( 0 );
+	forget();
+
+	CHECK_EQ( panel.due(), KNOB_TIME_NEVER );
+	CHECK( !readable( reactor.fd(), 50 ) );
+
+	// the edge is seen by a loop, the timer takes it through debouncing
+	sim().input( PIN, HIGH );
+	knob_time_t pressed = now();
+	reactor.service( 0 );
+	CHECK_EQ( callsOf( HT_PUSH ), 0 );
+	CHECK( panel.due() > 0 );
+
+	CHECK( readable( reactor.fd(), 1000 ) );
+	CHECK( reactor.service( 0 ) );
+	CHECK_EQ( callsOf( HT_PUSH ), 1 );
+	if( CHECK( firstOf( HT_PUSH ) ) ) {
+		CHECK( firstOf( HT_PUSH )->time - pressed >= DEBOUNCE );
+		CHECK( firstOf( HT_PUSH )->time - pressed < DEBOUNCE + KNOB_MS( 500 ) );
+	}
+
+	// held without Hold: idle again
+	CHECK_EQ( panel.due(), KNOB_TIME_NEVER );
+	CHECK( !readable( reactor.fd(), 50 ) );
+}
+
+// devices which want to be polled are looped every period
+static void testPeriod() {
+
+	Knob knob( "polled", PIN+1 );
+	Always always( record );
+	Panel panel( "panel", knob );
+	Reactor reactor;
+
+	knob.on( always );
+	reactor.period( KNOB_MS( 10 ) );
+	reactor << panel;
+	forget();
+
+	CHECK_EQ( panel.due(), 0 );
+
+	for( int i = 0; i < 5; i++ ) {
+		CHECK( readable( reactor.fd(), 1000 ) );
+		reactor.service( 0 );
+	}
+
+	CHECK( nCalls >= 5 );
+}
+
+int main() {
+
+	testArming();
+	testPeriod();
+
+	return checkResult();
+}
@@ -0,0 +1,318 @@
+/*
+ * Remote: Frames are found in garbage, split or bad ones don't
+ * execute, every frame is answered. RemotePort: watches end with
+ * their input, replies to a full output wait for room.
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+#include "Remote.h"
+
+// Reactor and RemotePort are built on Linux only
+#ifdef __linux__
+	#include "RemotePort.h"
+
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+// last reply
+static uint8_t reply[ REMOTE_FRAME ];
+static int replyLength = 0;
+static int replies = 0;
+
+static void send( const uint8_t *frame, uint8_t length, void *ctx ) {
+
+	memcpy( reply, frame, length );
+	replyLength = length;
+	replies++;
+}
+
+// true if the last reply was op to handle with data
+static bool replied( uint8_t op, uint8_t handle, const uint8_t *data, uint8_t length ) {
+
+	uint8_t want[ REMOTE_FRAME ];
+
+	return replyLength == Remote::frame( want, op, handle, data, length )
+			&& memcmp( reply, want, replyLength ) == 0;
+}
+
+static int feed( Remote &remote, uint8_t op, uint8_t handle,
+		const uint8_t *data=NULL, uint8_t length=0 ) {
+
+	uint8_t frame[ REMOTE_FRAME ];
+
+	return remote.feed( frame, Remote::frame( frame, op, handle, data, length ) );
+}
+
+static void testFrames() {
+
+	Valve v0( "v0", 30 ), v1( "v1", 31 );
+	Transducer transducer( "t", v0, v1 );
+	Remote remote;
+
+	transducer.begin();
+	remote << transducer << v0 << v1;
+	remote.output( send );
+
+	// checksum makes the sum 0
+	uint8_t frame[ REMOTE_FRAME ], sum = 0;
+	uint8_t on = 1;
+	CHECK_EQ( Remote::frame( frame, REMOTE_SET, 1, &on, 1 ), REMOTE_OVERHEAD + 1 );
+	CHECK_EQ( frame[ 0 ], REMOTE_SYNC );
+	for( int i = 1; i < REMOTE_OVERHEAD + 1; i++ ) sum += frame[ i ];
+	CHECK_EQ( sum, 0 );
+
+	feed( remote, REMOTE_PING, 0 );
+	CHECK_EQ( remote.poll(), 1 );
+	CHECK( replied( REMOTE_PING | REMOTE_REPLY, 0, NULL, 0 ) );
+
+	// set valve 1
+	feed( remote, REMOTE_SET, 1, &on, 1 );
+	CHECK_EQ( remote.poll(), 1 );
+	CHECK( v1.active() );
+	CHECK( !v0.active() );
+	uint8_t state = REMOTE_ACTIVE;
+	CHECK( replied( REMOTE_SET | REMOTE_REPLY, 1, &state, 1 ) );
+
+	// mask of transducer 0
+	uint8_t mask[ 4 ] = { 1, 0, 0, 0 };
+	feed( remote, REMOTE_MASK_SET, 0, mask, 4 );
+	CHECK_EQ( remote.poll(), 1 );
+	CHECK( v0.active() );
+	CHECK( !v1.active() );
+	CHECK( replied( REMOTE_MASK_SET | REMOTE_REPLY, 0, mask, 4 ) );
+
+	CHECK_EQ( remote.errors(), 0 );
+	CHECK_EQ( remote.fill(), 0 );
+}
+
+static void testBad() {
+
+	Valve v0( "v0", 32 );
+	Remote remote;
+	uint8_t frame[ REMOTE_FRAME ], length, on = 1;
+
+	v0.begin();
+	remote << v0;
+	remote.output( send );
+	replies = 0;
+
+	// garbage before is skipped
+	uint8_t garbage[] = { 0x00, 0x17, 0xff };
+	remote.feed( garbage, sizeof( garbage ) );
+	feed( remote, REMOTE_GET, 0 );
+	CHECK_EQ( remote.poll(), 1 );
+	CHECK_EQ( replies, 1 );
+
+	// split frame waits for the rest
+	length = Remote::frame( frame, REMOTE_SET, 0, &on, 1 );
+	remote.feed( frame, 3 );
+	CHECK_EQ( remote.poll(), 0 );
+	CHECK( !v0.active() );
+	remote.feed( frame + 3, length - 3 );
+	CHECK_EQ( remote.poll(), 1 );
+	CHECK( v0.active() );
+	CHECK_EQ( replies, 2 );
+
+	// bad check: not executed, not answered, the next one is found
+	length = Remote::frame( frame, REMOTE_SET, 0, NULL, 0 );
+	frame[ length-1 ]++;
+	remote.feed( frame, length );
+	feed( remote, REMOTE_PING, 0 );
+	CHECK_EQ( remote.poll(), 1 );
+	CHECK_EQ( remote.errors(), 1 );
+	CHECK( replied( REMOTE_PING | REMOTE_REPLY, 0, NULL, 0 ) );
+	CHECK( v0.active() );
+
+	// too long
+	frame[ 0 ] = REMOTE_SYNC;
+	frame[ 1 ] = REMOTE_PING;
+	frame[ 2 ] = 0;
+	frame[ 3 ] = KNOBS_REMOTE_PAYLOAD + 1;
+	remote.feed( frame, 4 );
+	feed( remote, REMOTE_PING, 0 );
+	CHECK_EQ( remote.poll(), 1 );
+	CHECK_EQ( remote.errors(), 2 );
+
+	// answered with errors
+	uint8_t error[ 2 ] = { REMOTE_GET, REMOTE_BAD_HANDLE };
+	feed( remote, REMOTE_GET, 5 );
+	CHECK_EQ( remote.poll(), 1 );
+	CHECK( replied( REMOTE_ERROR, 5, error, 2 ) );
+
+	error[ 0 ] = 0x42;
+	error[ 1 ] = REMOTE_BAD_OP;
+	feed( remote, 0x42, 0 );
+	CHECK_EQ( remote.poll(), 1 );
+	CHECK( replied( REMOTE_ERROR, 0, error, 2 ) );
+
+	error[ 0 ] = REMOTE_SET;
+	error[ 1 ] = REMOTE_BAD_LENGTH;
+	feed( remote, REMOTE_SET, 0 );
+	CHECK_EQ( remote.poll(), 1 );
+	CHECK( replied( REMOTE_ERROR, 0, error, 2 ) );
+	CHECK( v0.active() );
+}
+
+static void testFull() {
+
+	Remote remote;
+	int n = 0;
+
+	remote.output( send );
+
+	// keeps one byte free
+	while( remote.feed( (uint8_t)0 ) ) n++;
+	CHECK_EQ( n, KNOBS_REMOTE_BUFFER - 1 );
+	CHECK_EQ( remote.fill(), KNOBS_REMOTE_BUFFER - 1 );
+
+	// garbage is dropped on poll
+	CHECK_EQ( remote.poll(), 0 );
+	CHECK_EQ( remote.fill(), 0 );
+
+	// frames across the end of the buffer
+	replies = 0;
+	for( int i = 0; i < KNOBS_REMOTE_BUFFER; i++ ) {
+		feed( remote, REMOTE_PING, 0 );
+		remote.poll();
+	}
+	CHECK_EQ( replies, KNOBS_REMOTE_BUFFER );
+	CHECK_EQ( remote.errors(), 0 );
+}
+
+#ifdef __linux__
+static int reads = 0;
+
+static bool drain( int fd, void *ctx ) {
+
+	uint8_t buf[ 16 ];
+
+	reads++;
+
+	return read( fd, buf, sizeof( buf ) ) > 0;
+}
+
+// watches are dropped at end of input instead of firing forever
+static void testPort() {
+
+	Reactor reactor;
+	int fds[ 2 ];
+
+	if( !CHECK( pipe( fds ) == 0 ) ) return;
+
+	reactor.watch( fds[ 0 ], drain );
+	close( fds[ 1 ] );
+
+	reactor.service( 0 );
+	reactor.service( 0 );
+	CHECK_EQ( reads, 1 );
+	close( fds[ 0 ] );
+
+	// the pty is answered and closed when its client goes away
+	Valve v0( "v0", 33 );
+	Remote remote;
+	RemotePort port( remote );
+	char name[ 64 ];
+	uint8_t frame[ REMOTE_FRAME ];
+
+	v0.begin();
+	remote << v0;
+
+	// no ptys here
+	if( !port.pty( name, sizeof( name ) ) ) return;
+
+	port.watch( reactor );
+
+	int client = open( name, O_RDWR | O_NOCTTY );
+	if( !CHECK( client >= 0 ) ) return;
+
+	uint8_t length = Remote::frame( frame, REMOTE_PING, 0, NULL, 0 );
+	CHECK_EQ( write( client, frame, length ), length );
+	reactor.service( 100 );
+	CHECK_EQ( read( client, frame, sizeof( frame ) ), length );
+
+	close( client );
+	reactor.service( 100 );
+	CHECK_EQ( port.fd(), -1 );
+}
+
+// replies which would block are held back, not lost
+static void testFullOutput() {
+
+	Reactor reactor;
+	Valve v0( "v0", 34 );
+	Remote remote;
+	int in[ 2 ], out[ 2 ];
+	uint8_t frame[ REMOTE_FRAME ], pong[ REMOTE_FRAME ], buf[ 512 ];
+	int pings;
+
+	if( !CHECK( pipe( in ) == 0 && pipe( out ) == 0 ) ) return;
+
+	fcntl( in[ 0 ], F_SETFL, O_NONBLOCK );
+	fcntl( out[ 0 ], F_SETFL, O_NONBLOCK );
+	fcntl( out[ 1 ], F_SETFL, O_NONBLOCK );
+
+	RemotePort port( remote, in[ 0 ], out[ 1 ] );
+
+	v0.begin();
+	remote << v0;
+	port.watch( reactor );
+
+	// nobody reads the replies
+	while( write( out[ 1 ], buf, sizeof( buf ) ) > 0 );
+
+	uint8_t length = Remote::frame( frame, REMOTE_PING, 0, NULL, 0 );
+	Remote::frame( pong, REMOTE_PING | REMOTE_REPLY, 0, NULL, 0 );
+
+	for( pings = 0; pings < 3; pings++ ) CHECK_EQ( write( in[ 1 ], frame, length ), length );
+	reactor.service( 100 );
+
+	CHECK_EQ( port.pending(), 3*length );
+	CHECK_EQ( port.dropped(), 0 );
+
+	// room again
+	while( read( out[ 0 ], buf, sizeof( buf ) ) > 0 );
+
+	CHECK( reactor.service( 100 ) );
+	CHECK_EQ( port.pending(), 0 );
+
+	for( int i = 0; i < 3; i++ ) {
+		if( !CHECK_EQ( read( out[ 0 ], buf, length ), length ) ) break;
+		CHECK( memcmp( buf, pong, length ) == 0 );
+	}
+	CHECK( read( out[ 0 ], buf, length ) < 0 );
+
+	// more than can be held back: whole replies are dropped
+	while( write( out[ 1 ], buf, sizeof( buf ) ) > 0 );
+	for( pings = 0; pings < KNOBS_REMOTEPORT_PENDING/length + 4; pings++ ) {
+		CHECK_EQ( write( in[ 1 ], frame, length ), length );
+		reactor.service( 0 );
+	}
+
+	CHECK( port.dropped() > 0 );
+	CHECK_EQ( port.pending() % length, 0 );
+
+	close( in[ 0 ] );
+	close( in[ 1 ] );
+	close( out[ 0 ] );
+	close( out[ 1 ] );
+}
+#endif
+
+int main() {
+
+	testFrames();
+	testBad();
+	testFull();
+#ifdef __linux__
+	testPort();
+	testFullOutput();
+#endif
+
+	return checkResult();
+}
@@ -0,0 +1,113 @@
+/*
+ * Replay: Hours of samples only take the loops needed, outputs and
+ * handler calls come with exact times and the Host's clock is given
+ * back afterwards.
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+#include "Replay.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+#define KNOB 40
+#define VALVE 41
+
+#define SEC 1000000ull
+#define HOUR ( 3600 * SEC )
+
+static Valve *light;
+
+static bool toggle( Device &dev, Handler &handler,
+		knob_value_t newState, knob_value_t oldState, knob_time_t count ) {
+
+	Replay::log( dev, handler, newState, oldState, count );
+
+	light->toggle();
+
+	return true;
+}
+
+// run replay and return its output in text
+static uint32_t run( Replay &replay, char *text, int size, uint64_t tail ) {
+
+	FILE *out = tmpfile();
+
+	replay.output( out );
+	uint32_t ticks = replay.run( tail );
+	replay.output( NULL );
+
+	rewind( out );
+	size_t n = fread( text, 1, size-1, out );
+	text[ n ] = '\0';
+	fclose( out );
+
+	return ticks;
+}
+
+static void testReplay() {
+
+	Knob knob( "button", KNOB );
+	Push push( toggle );
+	Panel panel( "panel", knob );
+	Valve valve( "light", VALVE );
+	Transducer transducer( "t", valve );
+
+	light = &valve;
+	knob.on( push );
+	transducer.begin();
+
+	Replay replay;
+	char text[ 1024 ];
+
+	replay << panel << transducer;
+
+	// a short press and another one hours later
+	CHECK( replay.add( 1*SEC, KNOB, HIGH ) );
+	CHECK( replay.add( 1*SEC + 200000, KNOB, LOW ) );
+	CHECK( replay.add( 5*HOUR, KNOB, HIGH ) );
+	CHECK( replay.add( 5*HOUR + 200000, KNOB, LOW ) );
+	CHECK( !replay.add( 2*SEC, KNOB, HIGH ) );
+
+	uint32_t ticks = run( replay, text, sizeof( text ), SEC );
+
+	// push after debouncing. The level doesn't change meanwhile so
+	// the Knob is woken once when it is through.
+	char want[ 256 ];
+	long long count = KNOB_MS( 25 );
+	snprintf( want, sizeof( want ),
+		"1025000 button push 1 0 %lld\n"
+		"1025000 out 41 1\n"
+		"18000025000 button push 1 0 %lld\n"
+		"18000025000 out 41 0\n"
+		"18001200000 end light 0\n", count, count );
+
+	CHECK( strcmp( text, want ) == 0 );
+	if( strcmp( text, want ) ) fprintf( stderr, "%s", text );
+
+	// debouncing and nothing in between
+	CHECK( ticks < 20 );
+	CHECK_EQ( replay.ticks(), ticks );
+	CHECK_EQ( replay.now(), 5*HOUR + 1200000 );
+
+	// same again
+	CHECK_EQ( now(), KNOB_MS( ( 5*HOUR + 1200000 ) / 1000 ) );
+}
+
+int main() {
+
+	VirtualClock vclock;
+
+	use( vclock );
+	vclock.advance( 1000 );
+
+	testReplay();
+
+	// backends are given back
+	CHECK( &clock() == &vclock );
+	CHECK_EQ( now(), KNOB_MS( 1000 ) );
+
+	return checkResult();
+}
@@ -0,0 +1,163 @@
+/*
+ * ShiftRegister: A simulated chain of 74HC165 is latched and clocked
+ * out once per sample. D7 of the chip next to the MCU is Key 0, its D0
+ * Key 7 and D7 of the next chip Key 8.
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+#include "ShiftRegister.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+#define LOAD 40
+#define CLOCK 41
+#define DATA 42
+
+#define CHIPS 2
+
+static VirtualClock vclock;
+
+// 74HC165s in a chain. Chip 0 is next to the MCU, its Q7 on DATA.
+class Chain : public SimHal {
+
+	private:
+		// in the order they leave Q7
+		bool _bits[ CHIPS*8 ];
+		int _pos;
+
+	public:
+		// parallel inputs. d[ chip ] bit n is Dn
+		uint8_t d[ CHIPS ];
+		int loads, clocks;
+
+		Chain() : _pos( 0 ), loads( 0 ), clocks( 0 ) {
+			memset( d, 0, sizeof( d ) );
+			memset( _bits, 0, sizeof( _bits ) );
+		}
+
+		virtual void digitalWrite( pin_t pin, uint8_t val ) {
+
+			bool rise = val && !output( pin );
+
+			SimHal::digitalWrite( pin, val );
+
+			// PL is active low and latches while low
+			if( pin == LOAD && !val ) {
+
+				for( int chip = 0; chip < CHIPS; chip++ )
+					for( int n = 0; n < 8; n++ ) _bits[ chip*8 + 7-n ] = d[ chip ] & ( 1 << n );
+
+				_pos = 0;
+				loads++;
+			}
+
+			// DS of the last chip is tied low
+			if( pin == CLOCK && rise ) {
+				_pos++;
+				clocks++;
+			}
+		}
+
+		virtual int digitalRead( pin_t pin ) {
+
+			if( pin != DATA ) return SimHal::digitalRead( pin );
+
+			return _pos < CHIPS*8 && _bits[ _pos ] ? HIGH : LOW;
+		}
+};
+
+// debounced state after the inputs settled
+static bank_mask_t sample( ShiftRegister &bank ) {
+
+	runFor( bank, vclock, KNOB_MS( 50 ) );
+
+	return bank.state();
+}
+
+static void testOrder() {
+
+	Chain chain;
+
+	use( chain );
+
+	ShiftRegister bank( "165", LOAD, CLOCK, DATA, CHIPS );
+	Crate<Key, CHIPS*8> keys;
+	char names[ CHIPS*8 ][ 4 ];
+
+	for( int k = 0; k < CHIPS*8; k++ ) {
+		snprintf( names[ k ], sizeof( names[ k ] ), "k%d", k );
+		bank << *keys.make( names[ k ] );
+	}
+
+	CHECK_EQ( sample( bank ), 0 );
+
+	// D7 of chip 0 first
+	chain.d[ 0 ] = 0x80;
+	CHECK_EQ( sample( bank ), 1 << 0 );
+	CHECK_EQ( keys.get( 0 )->value(), 1 );
+
+	chain.d[ 0 ] = 0x01;
+	CHECK_EQ( sample( bank ), 1 << 7 );
+
+	chain.d[ 0 ] = 0;
+	chain.d[ 1 ] = 0x80;
+	CHECK_EQ( sample( bank ), 1 << 8 );
+
+	chain.d[ 1 ] = 0x01;
+	CHECK_EQ( sample( bank ), 1 << 15 );
+	CHECK_EQ( keys.get( 15 )->value(), 1 );
+
+	chain.d[ 0 ] = 0x12;
+	chain.d[ 1 ] = 0xc0;
+	CHECK_EQ( sample( bank ), ( 1 << 3 ) | ( 1 << 6 ) | ( 1 << 8 ) | ( 1 << 9 ) );
+
+	// one latch and all bits per sample
+	int loads = chain.loads, clocks = chain.clocks;
+	bank.loop( uptime() + KNOB_MS( 100 ) );
+	CHECK_EQ( chain.loads - loads, 1 );
+	CHECK_EQ( chain.clocks - clocks, CHIPS*8 );
+
+	use( sim() );
+}
+
+static void testInvert() {
+
+	Chain chain;
+
+	use( chain );
+
+	ShiftRegister bank( "inverted", LOAD, CLOCK, DATA, CHIPS );
+	Key k0( "k0" ), k1( "k1" );
+
+	bank << k0 << k1;
+	bank.invert( true );
+
+	// pulled up
+	chain.d[ 0 ] = chain.d[ 1 ] = 0xff;
+	CHECK_EQ( sample( bank ), 0 );
+
+	// pressed pulls low
+	chain.d[ 0 ] = 0xbf;
+	CHECK_EQ( sample( bank ), 1 << 1 );
+	CHECK_EQ( k1.value(), 1 );
+
+	// inputs without a Key are in the state, too
+	chain.d[ 0 ] = 0xff;
+	chain.d[ 1 ] = 0x7f;
+	CHECK_EQ( sample( bank ), 1 << 8 );
+
+	use( sim() );
+}
+
+int main() {
+
+	use( vclock );
+
+	testOrder();
+	testInvert();
+
+	return checkResult();
+}
@@ -0,0 +1,92 @@
+/*
+ * StaticKnob: Handlers fixed at compile time see the same activations
+ * as ones added with on(), run before them and take part in due().
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+#include "StaticKnob.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+#define PIN 5
+
+// debounce of Knob
+#define DEBOUNCE KNOB_MS( 25 )
+
+static VirtualClock vclock;
+
+static void testChain() {
+
+	StaticKnob<Push, Release, Hold> knob( "static", PIN,
+			Push( record ), Release( record ), Hold( record, KNOB_MS( 200 ) ) );
+	Toggle toggle( record );
+
+	knob.on( toggle );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	forget();
+
+	sim().input( PIN, HIGH );
+	runFor( knob, vclock, DEBOUNCE + KNOB_MS( 1 ) );
+
+	// static ones first
+	if( CHECK_EQ( nCalls, 2 ) ) {
+		CHECK_EQ( calls[ 0 ].type, HT_PUSH );
+		CHECK_EQ( calls[ 1 ].type, HT_TOGGLE );
+	}
+
+	runFor( knob, vclock, KNOB_MS( 300 ) );
+	CHECK_EQ( callsOf( HT_HOLD ), 1 );
+	if( CHECK( firstOf( HT_HOLD ) ) ) CHECK_EQ( firstOf( HT_HOLD )->count, KNOB_MS( 200 ) );
+
+	sim().input( PIN, LOW );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	CHECK_EQ( callsOf( HT_RELEASE ), 1 );
+
+	// handlers are reachable by position
+	knob.handler<2>().continues( true );
+	sim().input( PIN, HIGH );
+	runFor( knob, vclock, DEBOUNCE + KNOB_MS( 200 ) );
+	forget();
+	runFor( knob, vclock, KNOB_MS( 10 ) );
+	CHECK_EQ( callsOf( HT_HOLD ), 10 );
+
+	sim().input( PIN, LOW );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+}
+
+// without handlers of its own a Knob only polls while debouncing
+static void testDue() {
+
+	StaticKnob<Hold> knob( "due", PIN+1, Hold( record, KNOB_MS( 200 ) ) );
+
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+	forget();
+
+	CHECK_EQ( knob.due( now() ), KNOB_TIME_NEVER );
+
+	sim().input( PIN+1, HIGH );
+	runFor( knob, vclock, DEBOUNCE + KNOB_MS( 1 ) );
+
+	// the Hold is due. Pressed since the loop before
+	CHECK_EQ( knob.due( now() ), KNOB_MS( 200 - 1 ) );
+
+	pass( vclock, knob.due( now() ) );
+	knob.loop();
+	CHECK_EQ( callsOf( HT_HOLD ), 1 );
+
+	sim().input( PIN+1, LOW );
+	runFor( knob, vclock, KNOB_MS( 100 ) );
+}
+
+int main() {
+
+	use( vclock );
+
+	testChain();
+	testDue();
+
+	return checkResult();
+}
@@ -0,0 +1,175 @@
+/*
+ * Trace: Once the ring wrapped a dump holds the last KNOBS_TRACE
+ * records oldest first, long pauses get a record of their own and
+ * records made while dumping are counted as lost.
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+#include "Trace.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+#if KNOBS_TRACE
+
+// bytes of the dump header
+#define HEADER 13
+
+static VirtualClock vclock;
+
+static uint8_t dumped[ HEADER + KNOBS_TRACE_NAMES*( 2 + 0xff ) + KNOBS_TRACE*sizeof( TraceRecord ) ];
+static size_t length;
+
+// a record made while dumping
+static bool recordInDump;
+
+static void collect( const uint8_t *data, uint16_t n, void *ctx ) {
+
+	(void)ctx;
+
+	if( recordInDump ) trace.record( TRACE_ACTIVATE, 0, 1, 0 );
+
+	if( length + n > sizeof( dumped ) ) return;
+
+	memcpy( dumped + length, data, n );
+	length += n;
+}
+
+static uint32_t le( const uint8_t *at, int bytes ) {
+
+	uint32_t value = 0;
+
+	while( bytes-- ) value = value << 8 | at[ bytes ];
+
+	return value;
+}
+
+// dump and find the records in it
+static const TraceRecord *dump( uint16_t &records, uint32_t &lost ) {
+
+	const uint8_t *at = dumped + HEADER;
+
+	length = 0;
+	trace.dump( collect );
+
+	CHECK( memcmp( dumped, TRACE_MAGIC, 4 ) == 0 );
+	CHECK_EQ( dumped[ 4 ], TRACE_VERSION );
+
+	records = le( dumped + 7, 2 );
+	lost = le( dumped + 9, 4 );
+
+	// skip names
+	for( int i = 0; i < dumped[ 6 ]; i++ ) at += 2 + at[ 1 ];
+
+	CHECK_EQ( (size_t)( at - dumped ) + records*sizeof( TraceRecord ), length );
+
+	return (const TraceRecord*)at;
+}
+
+static void testWrap() {
+
+	const int total = KNOBS_TRACE + 4;
+	uint16_t records;
+	uint32_t lost;
+
+	trace.clear();
+	CHECK_EQ( trace.fill(), 0 );
+
+	for( int i = 0; i < total; i++ ) {
+		vclock.advance( 1 + i % 3 );
+		trace.record( TRACE_VALVE, 1, i, i - 1 );
+	}
+
+	CHECK_EQ( trace.fill(), KNOBS_TRACE );
+
+	const TraceRecord *record = dump( records, lost );
+
+	CHECK_EQ( records, KNOBS_TRACE );
+	CHECK_EQ( lost, 0 );
+
+	// the oldest ones were overwritten
+	for( int i = 0; i < records; i++ ) {
+
+		int made = total - KNOBS_TRACE + i;
+
+		if( !CHECK_EQ( record[ i ].newValue, made ) ) break;
+		CHECK_EQ( record[ i ].oldValue, made - 1 );
+		CHECK_EQ( record[ i ].kind, TRACE_VALVE );
+		CHECK_EQ( record[ i ].delta, KNOB_MS( 1 + made % 3 ) );
+	}
+}
+
+static void testPause() {
+
+	uint16_t records;
+	uint32_t lost;
+	knob_time_t pause = KNOB_MS( 70000 );
+
+	trace.clear();
+
+	vclock.advance( 1 );
+	trace.record( TRACE_ACTIVATE, 2, 1, 0 );
+	pass( vclock, pause );
+	trace.record( TRACE_ACTIVATE, 2, 0, 1 );
+
+	const TraceRecord *record = dump( records, lost );
+
+	// the whole delta in a record before
+	if( CHECK_EQ( records, 3 ) ) {
+		CHECK_EQ( record[ 1 ].kind, TRACE_TIME );
+		CHECK_EQ( record[ 1 ].delta, 0xffff );
+		CHECK_EQ( (uint32_t)(uint16_t)record[ 1 ].newValue << 16 | (uint16_t)record[ 1 ].oldValue, pause );
+		CHECK_EQ( record[ 2 ].kind, TRACE_ACTIVATE );
+		CHECK_EQ( record[ 2 ].delta, 0 );
+		CHECK_EQ( record[ 2 ].newValue, 0 );
+	}
+}
+
+static void testLost() {
+
+	uint16_t records;
+	uint32_t lost;
+
+	trace.clear();
+
+	trace.record( TRACE_ACTIVATE, 3, 1, 0 );
+
+	recordInDump = true;
+	dump( records, lost );
+	recordInDump = false;
+
+	// not in the dump, not recorded after it
+	CHECK_EQ( records, 1 );
+	CHECK_EQ( lost, 0 );
+	CHECK( trace.lost() > 0 );
+	CHECK_EQ( trace.fill(), 1 );
+
+	// the next dump tells
+	dump( records, lost );
+	CHECK_EQ( lost, trace.lost() );
+
+	trace.clear();
+	CHECK_EQ( trace.lost(), 0 );
+}
+
+int main() {
+
+	use( vclock );
+
+	testWrap();
+	testPause();
+	testLost();
+
+	return checkResult();
+}
+
+#else
+
+int main() {
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,184 @@
+/*
+ * TimedValve: switching off after its time with two warnings before
+ * and the due() which leads there. ShiftOutlet: one latch per change,
+ * PortOutlet: one register write per port.
+ */
+
+#include <Arduino.h>
+
+#include "Check.h"
+#include "Outlet.h"
+#include "Valve.h"
+
+using namespace Knobs;
+using namespace Knobs::Host;
+
+#define PIN 10
+// first pin of a port
+#define PORT_PIN 16
+
+static VirtualClock vclock;
+
+// level changes of PIN
+static knob_time_t changes[ 16 ];
+static value_t levels[ 16 ];
+static int nChanges = 0;
+
+static void output( pin_t pin, value_t value, knob_time_t time ) {
+
+	if( pin != PIN || nChanges >= 16 ) return;
+	if( nChanges && levels[ nChanges-1 ] == value ) return;
+
+	changes[ nChanges ] = time;
+	levels[ nChanges ] = value;
+	nChanges++;
+}
+
+static void testTimedValve() {
+
+	// off after 5 s. Blinks 1 s and 0.5 s before.
+	TimedValve valve( "timed", PIN, KNOB_MS( 5000 ), KNOB_MS( 1000 ), KNOB_MS( 500 ) );
+	Transducer transducer( "t", valve );
+
+	transducer.begin();
+	runFor( transducer, vclock, KNOB_MS( 10 ) );
+
+	CHECK_EQ( transducer.due(), KNOB_TIME_NEVER );
+
+	sim().onOutput( output );
+
+	knob_time_t on = now();
+	valve.on();
+
+	CHECK_EQ( sim().output( PIN ), HIGH );
+
+	// started at the next loop
+	runFor( transducer, vclock, KNOB_MS( 10 ) );
+	// first warning 4 s after the start plus one unit (see _TIME)
+	CHECK_EQ( transducer.due(), KNOB_MS( 4001 - 10 ) + 1 );
+
+	runFor( transducer, vclock, KNOB_MS( 6000 ) );
+
+	CHECK( !valve.active() );
+	CHECK_EQ( sim().output( PIN ), LOW );
+
+	// on, 2 warnings of _TP_WARNING each, off
+	if( CHECK_EQ( nChanges, 6 ) ) {
+		CHECK_EQ( changes[ 0 ] - on, 0 );
+		CHECK_EQ( changes[ 1 ] - on, KNOB_MS( 4002 ) );
+		CHECK_EQ( changes[ 2 ] - on, KNOB_MS( 4102 ) );
+		CHECK_EQ( changes[ 3 ] - on, KNOB_MS( 4502 ) );
+		CHECK_EQ( changes[ 4 ] - on, KNOB_MS( 4602 ) );
+		CHECK_EQ( changes[ 5 ] - on, KNOB_MS( 5002 ) );
+	}
+
+	CHECK_EQ( transducer.due(), KNOB_TIME_NEVER );
+
+	sim().onOutput( NULL );
+}
+
+static void testRestart() {
+
+	TimedValve valve( "restart", PIN+1, KNOB_MS( 1000 ), 0, 0 );
+	Transducer transducer( "t", valve );
+
+	transducer.begin();
+	runFor( transducer, vclock, KNOB_MS( 10 ) );
+
+	valve.on();
+	runFor( transducer, vclock, KNOB_MS( 900 ) );
+
+	// turning on again doesn't extend
+	valve.on();
+	runFor( transducer, vclock, KNOB_MS( 200 ) );
+	CHECK( !valve.active() );
+
+	// reset() does
+	valve.on();
+	runFor( transducer, vclock, KNOB_MS( 900 ) );
+	valve.timer().reset();
+	runFor( transducer, vclock, KNOB_MS( 900 ) );
+	CHECK( valve.active() );
+	runFor( transducer, vclock, KNOB_MS( 200 ) );
+	CHECK( !valve.active() );
+}
+
+// the chain is latched once with the state of all Valves
+static void testShiftOutlet() {
+
+	ShiftOutlet chain( 50, 51, 52, 1 );
+	Valve a( "a", 0 ), b( "b", 1 );
+	Transducer transducer( "t", a, b );
+
+	a.outlet( chain ).invert( true );
+	b.outlet( chain );
+
+	uint32_t latched = sim().writes( 50 );
+
+	transducer.begin();
+	CHECK_EQ( sim().writes( 50 ) - latched, 2 );
+	CHECK( chain.read( 0 ) );
+	CHECK( !chain.read( 1 ) );
+
+	transducer.activeMask( 3 );
+	CHECK_EQ( sim().writes( 50 ) - latched, 4 );
+	CHECK( !chain.read( 0 ) );
+	CHECK( chain.read( 1 ) );
+}
+
+// pin mode when the level of PORT_PIN was written
+static uint8_t modeAtWrite;
+
+static void portOutput( pin_t pin, value_t value, knob_time_t time ) {
+
+	if( pin == PORT_PIN+2 ) modeAtWrite = sim().mode( pin );
+}
+
+// Valves on one port switch with one write of its register
+static void testPortOutlet() {
+
+	Valve a( "a", PORT_PIN ), b( "b", PORT_PIN+1 ), c( "c", PORT_PIN+2 );
+	Transducer transducer( "t", a, b, c );
+
+	CHECK( PortOutlet::supports( PORT_PIN ) );
+
+	a.invert( true );
+	c.inputWhenOff( true );
+	transducer.usePorts().begin();
+
+	CHECK_EQ( sim().output( PORT_PIN ), HIGH );
+	CHECK_EQ( sim().output( PORT_PIN+1 ), LOW );
+	CHECK_EQ( sim().mode( PORT_PIN+1 ), OUTPUT );
+	CHECK_EQ( sim().mode( PORT_PIN+2 ), INPUT );
+
+	uint32_t writes = sim().writes( PORT_PIN ) + sim().writes( PORT_PIN+1 );
+
+	transducer.activeMask( 3 );
+	CHECK_EQ( sim().output( PORT_PIN ), LOW );
+	CHECK_EQ( sim().output( PORT_PIN+1 ), HIGH );
+	CHECK_EQ( sim().writes( PORT_PIN ) + sim().writes( PORT_PIN+1 ) - writes, 2 );
+
+	// level before the pin drives it
+	sim().onOutput( portOutput );
+	modeAtWrite = OUTPUT;
+	c.on();
+	CHECK_EQ( modeAtWrite, INPUT );
+	CHECK_EQ( sim().mode( PORT_PIN+2 ), OUTPUT );
+	CHECK_EQ( sim().output( PORT_PIN+2 ), HIGH );
+	sim().onOutput( NULL );
+
+	c.off();
+	CHECK_EQ( sim().mode( PORT_PIN+2 ), INPUT );
+}
+
+int main() {
+
+	use( vclock );
+
+	testTimedValve();
+	testRestart();
+	testShiftOutlet();
+	testPortOutlet();
+
+	return checkResult();
+}
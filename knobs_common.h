@@ -3,14 +3,60 @@
 
 #include <stdint.h>
 
+// Highest port number +1 which can be sampled/written. (ATmega2560 has PA=1 .. PL=12)
+#ifndef KNOBS_PORTS
+	#define KNOBS_PORTS 13
+#endif
+#if KNOBS_PORTS > 16
+	#error "KNOBS_PORTS must not exceed 16"
+#endif
+
+// Block interrupts and give their state back afterwards. Unlike
+// noInterrupts()/interrupts() this can be used within an ISR, too:
+//   knobs_irq_t irq;  KNOBS_LOCK( irq );  ...  KNOBS_UNLOCK( irq );
+#if defined( __AVR__ )
+	#define KNOBS_LOCK( s ) do { (s) = SREG; cli(); } while( 0 )
+	#define KNOBS_UNLOCK( s ) do { SREG = (s); } while( 0 )
+#elif defined( __ARM_ARCH_6M__ ) || defined( __ARM_ARCH_7M__ ) || defined( __ARM_ARCH_7EM__ )
+	#define KNOBS_LOCK( s ) __asm__ volatile( "mrs %0, primask\n\tcpsid i" : "=r"( s ) :: "memory" )
+	#define KNOBS_UNLOCK( s ) __asm__ volatile( "msr primask, %0" :: "r"( s ) : "memory" )
+#else
+	// state unknown: enabled afterwards
+	#define KNOBS_LOCK( s ) do { (s) = 0; noInterrupts(); } while( 0 )
+	#define KNOBS_UNLOCK( s ) do { (void)(s); interrupts(); } while( 0 )
+#endif
+
 namespace Knobs {
 
 	typedef uint8_t pin_t;
+
+#if defined( __ARM_ARCH_6M__ ) || defined( __ARM_ARCH_7M__ ) || defined( __ARM_ARCH_7EM__ )
+	typedef uint32_t knobs_irq_t;
+#else
+	typedef uint8_t knobs_irq_t;
+#endif
+
+	// for devices without a pin of their own
+	#define KNOBS_NO_PIN 0xff
 	typedef uint32_t value_t;
 	typedef int32_t knob_value_t;
 	typedef int64_t big_knob_value_t;
 	typedef int64_t knob_time_t;
 	typedef float knob_float_t;
+
+	// returned by due() if nothing is going to happen by itself
+	#define KNOB_TIME_NEVER INT64_MAX
+
+	// Times are counted in milliseconds. Define KNOBS_MICROS to count
+	// in microseconds. Use these to write times independent of that.
+	#ifdef KNOBS_MICROS
+		#define KNOB_US( us ) ( (knob_time_t)(us) )
+		#define KNOB_MS( ms ) ( (knob_time_t)(ms) * 1000 )
+	#else
+		#define KNOB_US( us ) ( (knob_time_t)(us) / 1000 )
+		#define KNOB_MS( ms ) ( (knob_time_t)(ms) )
+	#endif
+	#define KNOB_SEC( s ) KNOB_MS( (knob_time_t)(s) * 1000 )
 }
 
 #endif